@@ -0,0 +1,934 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <forward_list>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "benchmark_support.h"
+#include "../BinarySearchTree/binary_search_tree.h"
+#include "../BinarySearchTree/concurrent_binary_search_tree.h"
+#include "../SinglyLinkedList/concurrent_queue.h"
+#include "../SinglyLinkedList/singly_linked_list.h"
+#include "../SinglyLinkedList/skip_list.h"
+
+// replacement allocation functions: every allocation of the process is counted
+// gcc takes the malloc/free inside of them for a mismatch with new/delete at the inlined call sites
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    allocation_count().fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// over-aligned types (e.g. the alignas(64) members of the concurrent containers) go through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocation_count().fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants the size to be a multiple of the alignment
+    void* ptr = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+    if (ptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+struct benchmark_options
+{
+    result_writer::format format = result_writer::format::csv;
+    // sizes go from 1K up to max_size by the factor of 10
+    size_t max_size = 1000000;
+    // unbalanced tree built from sorted keys is a linked list, the quadratic build is skipped above this size
+    size_t degenerate_limit = 20000;
+    // linear lookups of the lists are sampled instead of running n of them
+    size_t linear_probes = 1000;
+    size_t max_threads = 64;
+    std::string suite;
+    uint64_t seed = 42;
+};
+
+// fixed part of the results of one benchmark case
+struct case_context
+{
+    result_writer& writer;
+    const char* suite;
+    const char* key_type;
+    const char* order;
+    size_t size;
+    size_t threads;
+
+    void report(const char* container, const char* operation, const measurement& result, size_t operations) const
+    {
+        operations = std::max<size_t>(operations, 1);
+        writer.write({suite, container, operation, key_type, order, size, threads, operations,
+                      result.nanoseconds() / static_cast<double>(operations),
+                      static_cast<double>(result.allocations()) / static_cast<double>(operations), peak_rss_kb()});
+    }
+};
+
+// something cheap that depends on the value, so the iterations really read it
+inline uint64_t key_weight(const int value)
+{
+    return static_cast<uint64_t>(value);
+}
+
+inline uint64_t key_weight(const int64_t value)
+{
+    return static_cast<uint64_t>(value);
+}
+
+inline uint64_t key_weight(const std::string& value)
+{
+    return value.size() + static_cast<unsigned char>(value.back());
+}
+
+std::vector<size_t> benchmark_sizes(const benchmark_options& options)
+{
+    std::vector<size_t> sizes;
+    for (size_t size = 1000; size <= options.max_size; size *= 10)
+    {
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+std::vector<size_t> thread_counts(const benchmark_options& options)
+{
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads <= options.max_threads; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    return counts;
+}
+
+// CONTAINERS
+// binary_search_tree and singly_linked_list against std::set and std::forward_list
+
+template <typename T>
+void bench_binary_search_tree(const case_context& context, const std::vector<T>& keys, const std::vector<T>& lookups)
+{
+    uint64_t checksum = 0;
+    binary_search_tree<T> tree;
+
+    measurement add;
+    for (const auto& key : keys)
+    {
+        checksum += tree.add(key);
+    }
+    add.stop();
+    context.report("binary_search_tree", "add", add, keys.size());
+
+    measurement find;
+    for (const auto& key : lookups)
+    {
+        checksum += tree.find(key) != nullptr;
+    }
+    find.stop();
+    context.report("binary_search_tree", "find", find, lookups.size());
+
+    measurement inorder;
+    for (auto elem = tree.begin_inorder(); elem != tree.end_inorder(); ++elem)
+    {
+        checksum += key_weight(*elem);
+    }
+    inorder.stop();
+    context.report("binary_search_tree", "iterate_inorder", inorder, tree.size());
+
+    measurement preorder;
+    for (auto elem = tree.begin_preorder(); elem != tree.end_preorder(); ++elem)
+    {
+        checksum += key_weight(*elem);
+    }
+    preorder.stop();
+    context.report("binary_search_tree", "iterate_preorder", preorder, tree.size());
+
+    measurement postorder;
+    for (auto elem = tree.begin_postorder(); elem != tree.end_postorder(); ++elem)
+    {
+        checksum += key_weight(*elem);
+    }
+    postorder.stop();
+    context.report("binary_search_tree", "iterate_postorder", postorder, tree.size());
+
+    measurement copy;
+    auto tree_copy = std::make_unique<binary_search_tree<T>>(tree);
+    copy.stop();
+    context.report("binary_search_tree", "copy", copy, tree.size());
+
+    measurement destruction;
+    tree_copy.reset();
+    destruction.stop();
+    context.report("binary_search_tree", "destruction", destruction, tree.size());
+
+    measurement remove;
+    for (const auto& key : lookups)
+    {
+        checksum += tree.remove(key);
+    }
+    remove.stop();
+    context.report("binary_search_tree", "remove", remove, lookups.size());
+
+    do_not_optimize(checksum);
+}
+
+template <typename T>
+void bench_std_set(const case_context& context, const std::vector<T>& keys, const std::vector<T>& lookups)
+{
+    uint64_t checksum = 0;
+    std::set<T> set;
+
+    measurement add;
+    for (const auto& key : keys)
+    {
+        checksum += set.insert(key).second;
+    }
+    add.stop();
+    context.report("std::set", "add", add, keys.size());
+
+    measurement find;
+    for (const auto& key : lookups)
+    {
+        checksum += set.find(key) != set.end();
+    }
+    find.stop();
+    context.report("std::set", "find", find, lookups.size());
+
+    measurement inorder;
+    for (const auto& key : set)
+    {
+        checksum += key_weight(key);
+    }
+    inorder.stop();
+    context.report("std::set", "iterate_inorder", inorder, set.size());
+
+    measurement copy;
+    auto set_copy = std::make_unique<std::set<T>>(set);
+    copy.stop();
+    context.report("std::set", "copy", copy, set.size());
+
+    measurement destruction;
+    set_copy.reset();
+    destruction.stop();
+    context.report("std::set", "destruction", destruction, set.size());
+
+    measurement remove;
+    for (const auto& key : lookups)
+    {
+        checksum += set.erase(key);
+    }
+    remove.stop();
+    context.report("std::set", "remove", remove, lookups.size());
+
+    do_not_optimize(checksum);
+}
+
+template <typename T>
+void bench_singly_linked_list(const case_context& context, const std::vector<T>& keys, const std::vector<T>& probes)
+{
+    uint64_t checksum = 0;
+    singly_linked_list<T> list;
+
+    measurement push_back;
+    for (const auto& key : keys)
+    {
+        list.push_back(key);
+    }
+    push_back.stop();
+    context.report("singly_linked_list", "push_back", push_back, keys.size());
+
+    {
+        singly_linked_list<T> front_list;
+        measurement push_forward;
+        for (const auto& key : keys)
+        {
+            front_list.push_forward(key);
+        }
+        push_forward.stop();
+        context.report("singly_linked_list", "push_forward", push_forward, keys.size());
+    }
+
+    measurement contains;
+    for (const auto& key : probes)
+    {
+        checksum += list.contains(key);
+    }
+    contains.stop();
+    context.report("singly_linked_list", "contains", contains, probes.size());
+
+    measurement copy;
+    auto list_copy = std::make_unique<singly_linked_list<T>>(list);
+    copy.stop();
+    context.report("singly_linked_list", "copy", copy, list.length());
+
+    measurement destruction;
+    list_copy.reset();
+    destruction.stop();
+    context.report("singly_linked_list", "destruction", destruction, list.length());
+
+    measurement remove;
+    for (const auto& key : probes)
+    {
+        list.remove(key);
+    }
+    remove.stop();
+    context.report("singly_linked_list", "remove", remove, probes.size());
+
+    do_not_optimize(checksum);
+}
+
+template <typename T>
+void bench_std_forward_list(const case_context& context, const std::vector<T>& keys, const std::vector<T>& probes)
+{
+    uint64_t checksum = 0;
+    std::forward_list<T> list;
+
+    // forward_list has no push_back, the iterator to the last element plays the tail
+    measurement push_back;
+    auto last = list.before_begin();
+    for (const auto& key : keys)
+    {
+        last = list.insert_after(last, key);
+    }
+    push_back.stop();
+    context.report("std::forward_list", "push_back", push_back, keys.size());
+
+    {
+        std::forward_list<T> front_list;
+        measurement push_forward;
+        for (const auto& key : keys)
+        {
+            front_list.push_front(key);
+        }
+        push_forward.stop();
+        context.report("std::forward_list", "push_forward", push_forward, keys.size());
+    }
+
+    measurement contains;
+    for (const auto& key : probes)
+    {
+        checksum += std::find(list.begin(), list.end(), key) != list.end();
+    }
+    contains.stop();
+    context.report("std::forward_list", "contains", contains, probes.size());
+
+    measurement copy;
+    auto list_copy = std::make_unique<std::forward_list<T>>(list);
+    copy.stop();
+    context.report("std::forward_list", "copy", copy, keys.size());
+
+    measurement destruction;
+    list_copy.reset();
+    destruction.stop();
+    context.report("std::forward_list", "destruction", destruction, keys.size());
+
+    // same semantics as singly_linked_list::remove - only the first match
+    measurement remove;
+    for (const auto& key : probes)
+    {
+        for (auto prev = list.before_begin(), current = list.begin(); current != list.end(); prev = current++)
+        {
+            if (*current == key)
+            {
+                list.erase_after(prev);
+                break;
+            }
+        }
+    }
+    remove.stop();
+    context.report("std::forward_list", "remove", remove, probes.size());
+
+    do_not_optimize(checksum);
+}
+
+template <typename T>
+void run_container_suite(result_writer& writer, const benchmark_options& options)
+{
+    std::mt19937_64 generator(options.seed);
+    for (const size_t size : benchmark_sizes(options))
+    {
+        for (const key_order order : {key_order::sorted, key_order::random, key_order::zipf})
+        {
+            const std::vector<T> keys = make_keys<T>(make_key_indices(size, order, generator));
+            std::vector<T> lookups = keys;
+            std::shuffle(lookups.begin(), lookups.end(), generator);
+            const std::vector<T> probes(lookups.begin(),
+                                        lookups.begin() + static_cast<std::ptrdiff_t>(std::min(size, options.linear_probes)));
+
+            const case_context context{writer, "containers", key_type_name<T>(), key_order_name(order), size, 1};
+            if (order != key_order::sorted || size <= options.degenerate_limit)
+            {
+                bench_binary_search_tree(context, keys, lookups);
+            }
+            else
+            {
+                std::cerr << "Skipping binary_search_tree for " << size << " sorted keys: quadratic build" << std::endl;
+            }
+            bench_std_set(context, keys, lookups);
+            bench_singly_linked_list(context, keys, probes);
+            bench_std_forward_list(context, keys, probes);
+        }
+    }
+}
+
+// SPLAY
+// lookups of the self-adjusting tree under the uniform and the skewed access
+
+void run_splay_suite(result_writer& writer, const benchmark_options& options)
+{
+    std::mt19937_64 generator(options.seed);
+    for (const size_t size : benchmark_sizes(options))
+    {
+        const std::vector<int> keys = make_keys<int>(make_key_indices(size, key_order::random, generator));
+        std::vector<int> uniform_lookups(size);
+        std::uniform_int_distribution<int> uniform(0, static_cast<int>(size) - 1);
+        for (auto& key : uniform_lookups)
+        {
+            key = uniform(generator);
+        }
+        const std::vector<int> zipf_lookups = make_keys<int>(make_key_indices(size, key_order::zipf, generator));
+
+        using adaptation = binary_search_tree<int>::access_adaptation;
+        const std::pair<adaptation, const char*> adaptations[] = {
+            {adaptation::none, "binary_search_tree/none"},
+            {adaptation::splay, "binary_search_tree/splay"},
+            {adaptation::semi_splay, "binary_search_tree/semi_splay"}};
+
+        const std::pair<const std::vector<int>*, const char*> workloads[] = {
+            {&uniform_lookups, "uniform"},
+            {&zipf_lookups, "zipf"}};
+
+        for (const auto& [mode, name] : adaptations)
+        {
+            for (const auto& [lookups, order] : workloads)
+            {
+                binary_search_tree<int> tree;
+                for (const int key : keys)
+                {
+                    tree.add(key);
+                }
+                tree.set_access_adaptation(mode);
+
+                uint64_t checksum = 0;
+                measurement find;
+                for (const int key : *lookups)
+                {
+                    checksum += tree.find(key) != nullptr;
+                }
+                find.stop();
+                do_not_optimize(checksum);
+
+                const case_context context{writer, "splay", "int", order, size, 1};
+                context.report(name, "find", find, lookups->size());
+            }
+        }
+    }
+}
+
+// CONCURRENT TREE
+// reader scaling of the lock-free lookups, alone and next to a writer
+
+void run_concurrent_tree_suite(result_writer& writer, const benchmark_options& options)
+{
+    std::mt19937_64 generator(options.seed);
+    const size_t size = std::min<size_t>(options.max_size, 1000000);
+    const std::vector<int> keys = make_keys<int>(make_key_indices(size, key_order::random, generator));
+    concurrent_binary_search_tree<int> tree;
+    for (const int key : keys)
+    {
+        tree.add(key);
+    }
+
+    // the total work is fixed, so ns_per_op shows the throughput of all the threads together
+    const size_t total_lookups = 2 * size;
+    for (const bool with_writer : {false, true})
+    {
+        for (const size_t threads : thread_counts(options))
+        {
+            std::atomic<bool> stop_writer{false};
+            std::thread writer_thread;
+            if (with_writer)
+            {
+                // keys above the range of the readers, so their results don't change
+                writer_thread = std::thread([&tree, &stop_writer, size]
+                {
+                    for (int key = static_cast<int>(size); !stop_writer.load(std::memory_order_relaxed); ++key)
+                    {
+                        tree.add(key);
+                        tree.remove(key);
+                    }
+                });
+            }
+
+            std::vector<std::thread> readers;
+            measurement find;
+            for (size_t idx = 0; idx < threads; ++idx)
+            {
+                readers.emplace_back([&tree, &keys, idx, threads, total_lookups]
+                {
+                    uint64_t checksum = 0;
+                    for (size_t lookup = idx; lookup < total_lookups; lookup += threads)
+                    {
+                        checksum += tree.contains(keys[lookup % keys.size()]);
+                    }
+                    do_not_optimize(checksum);
+                });
+            }
+            for (auto& reader : readers)
+            {
+                reader.join();
+            }
+            find.stop();
+
+            if (with_writer)
+            {
+                stop_writer = true;
+                writer_thread.join();
+            }
+
+            const case_context context{writer, "concurrent_tree", "int", "random", size, threads};
+            context.report("concurrent_binary_search_tree", with_writer ? "contains_with_writer" : "contains", find,
+                           total_lookups);
+        }
+    }
+}
+
+// QUEUE
+// producer/consumer throughput of the lock-free queue against the mutex guarded list
+
+// the way singly_linked_list is used as a work queue today: every operation under one mutex
+class locked_list_queue
+{
+public:
+    void push(const int value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        list_.push_back(value);
+    }
+
+    bool try_pop(int& value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (list_.length() == 0)
+        {
+            return false;
+        }
+        // remove deletes the first match, which is the head
+        value = *list_.begin();
+        list_.remove(value);
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    singly_linked_list<int> list_;
+};
+
+template <typename Push, typename Pop>
+measurement run_producers_consumers(const size_t pairs, const size_t items, Push push, Pop pop)
+{
+    std::atomic<size_t> consumed{0};
+    std::vector<std::thread> threads;
+    measurement result;
+    for (size_t idx = 0; idx < pairs; ++idx)
+    {
+        threads.emplace_back([&push, idx, pairs, items]
+        {
+            for (size_t item = idx; item < items; item += pairs)
+            {
+                push(static_cast<int>(item));
+            }
+        });
+        threads.emplace_back([&pop, &consumed, items]
+        {
+            uint64_t checksum = 0;
+            while (consumed.load(std::memory_order_relaxed) < items)
+            {
+                const size_t popped = pop(checksum);
+                if (popped > 0)
+                {
+                    consumed.fetch_add(popped, std::memory_order_relaxed);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            do_not_optimize(checksum);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    result.stop();
+    return result;
+}
+
+void run_queue_suite(result_writer& writer, const benchmark_options& options)
+{
+    const size_t items = std::min<size_t>(options.max_size, 1000000);
+    constexpr size_t batch_size = 64;
+
+    for (const size_t threads : thread_counts(options))
+    {
+        // half of the threads produce, half consume
+        if (threads < 2)
+        {
+            continue;
+        }
+        const size_t pairs = threads / 2;
+        const case_context context{writer, "queue", "int", "fifo", items, threads};
+
+        {
+            locked_list_queue queue;
+            const measurement result = run_producers_consumers(
+                pairs, items, [&queue](const int value) { queue.push(value); },
+                [&queue](uint64_t& checksum) -> size_t
+                {
+                    int value;
+                    if (!queue.try_pop(value))
+                    {
+                        return 0;
+                    }
+                    checksum += static_cast<uint64_t>(value);
+                    return 1;
+                });
+            context.report("mutex+singly_linked_list", "push_pop", result, items);
+        }
+
+        {
+            concurrent_queue<int> queue;
+            const measurement result = run_producers_consumers(
+                pairs, items, [&queue](const int value) { queue.push(value); },
+                [&queue](uint64_t& checksum) -> size_t
+                {
+                    const std::optional<int> value = queue.try_pop();
+                    if (!value)
+                    {
+                        return 0;
+                    }
+                    checksum += static_cast<uint64_t>(*value);
+                    return 1;
+                });
+            context.report("concurrent_queue", "push_pop", result, items);
+        }
+
+        {
+            concurrent_queue<int> queue;
+            std::vector<int> values(items);
+            for (size_t idx = 0; idx < items; ++idx)
+            {
+                values[idx] = static_cast<int>(idx);
+            }
+
+            // every producer pushes its share in batches
+            std::vector<std::thread> producers;
+            std::atomic<size_t> consumed{0};
+            std::vector<std::thread> consumers;
+            measurement result;
+            const size_t share = (items + pairs - 1) / pairs;
+            for (size_t idx = 0; idx < pairs; ++idx)
+            {
+                producers.emplace_back([&queue, &values, idx, share, items]
+                {
+                    const size_t begin = std::min(idx * share, items);
+                    const size_t end = std::min(begin + share, items);
+                    for (size_t batch = begin; batch < end; batch += batch_size)
+                    {
+                        queue.push_many(values.begin() + static_cast<std::ptrdiff_t>(batch),
+                                        values.begin() + static_cast<std::ptrdiff_t>(std::min(batch + batch_size, end)));
+                    }
+                });
+                consumers.emplace_back([&queue, &consumed, items]
+                {
+                    std::vector<int> popped;
+                    popped.reserve(batch_size);
+                    uint64_t checksum = 0;
+                    while (consumed.load(std::memory_order_relaxed) < items)
+                    {
+                        popped.clear();
+                        const size_t count = queue.pop_many(std::back_inserter(popped), batch_size);
+                        if (count == 0)
+                        {
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        for (const int value : popped)
+                        {
+                            checksum += static_cast<uint64_t>(value);
+                        }
+                        consumed.fetch_add(count, std::memory_order_relaxed);
+                    }
+                    do_not_optimize(checksum);
+                });
+            }
+            for (auto& producer : producers)
+            {
+                producer.join();
+            }
+            for (auto& consumer : consumers)
+            {
+                consumer.join();
+            }
+            result.stop();
+            context.report("concurrent_queue", "push_pop_many", result, items);
+        }
+    }
+}
+
+// SKIP LIST
+// ordered set alternatives: skip list against the unbalanced tree, single threaded and with concurrent inserts
+
+void run_skip_list_suite(result_writer& writer, const benchmark_options& options)
+{
+    std::mt19937_64 generator(options.seed);
+    for (const size_t size : benchmark_sizes(options))
+    {
+        for (const key_order order : {key_order::sorted, key_order::random})
+        {
+            const std::vector<int> keys = make_keys<int>(make_key_indices(size, order, generator));
+            std::vector<int> lookups = keys;
+            std::shuffle(lookups.begin(), lookups.end(), generator);
+            const case_context context{writer, "skip_list", "int", key_order_name(order), size, 1};
+            uint64_t checksum = 0;
+
+            {
+                skip_list<int> list;
+                measurement insert;
+                for (const int key : keys)
+                {
+                    checksum += list.insert(key);
+                }
+                insert.stop();
+                context.report("skip_list", "insert", insert, keys.size());
+
+                measurement contains;
+                for (const int key : lookups)
+                {
+                    checksum += list.contains(key);
+                }
+                contains.stop();
+                context.report("skip_list", "contains", contains, lookups.size());
+            }
+
+            if (order != key_order::sorted || size <= options.degenerate_limit)
+            {
+                binary_search_tree<int> tree;
+                measurement insert;
+                for (const int key : keys)
+                {
+                    checksum += tree.add(key);
+                }
+                insert.stop();
+                context.report("binary_search_tree", "insert", insert, keys.size());
+
+                measurement contains;
+                for (const int key : lookups)
+                {
+                    checksum += tree.contains(key);
+                }
+                contains.stop();
+                context.report("binary_search_tree", "contains", contains, lookups.size());
+            }
+
+            // lock-free inserts, the keys are dealt to the threads round robin
+            for (const size_t threads : thread_counts(options))
+            {
+                if (threads == 1)
+                {
+                    continue;
+                }
+                skip_list<int> list;
+                std::vector<std::thread> inserters;
+                measurement insert;
+                for (size_t idx = 0; idx < threads; ++idx)
+                {
+                    inserters.emplace_back([&list, &keys, idx, threads]
+                    {
+                        for (size_t key = idx; key < keys.size(); key += threads)
+                        {
+                            list.insert(keys[key]);
+                        }
+                    });
+                }
+                for (auto& inserter : inserters)
+                {
+                    inserter.join();
+                }
+                insert.stop();
+                const case_context threads_context{writer, "skip_list", "int", key_order_name(order), size, threads};
+                threads_context.report("skip_list", "insert", insert, keys.size());
+            }
+
+            do_not_optimize(checksum);
+        }
+    }
+}
+
+void print_usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--format csv|json] [--max-size N] [--max-threads N]"
+              << " [--degenerate-limit N] [--linear-probes N] [--seed N]"
+              << " [--suite containers|splay|concurrent_tree|queue|skip_list]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    benchmark_options options;
+    for (int idx = 1; idx < argc; ++idx)
+    {
+        const std::string arg = argv[idx];
+        if (idx + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[++idx];
+
+        if (arg == "--format" && (value == "csv" || value == "json"))
+        {
+            options.format = value == "csv" ? result_writer::format::csv : result_writer::format::json;
+        }
+        else if (arg == "--max-size")
+        {
+            options.max_size = std::stoull(value);
+        }
+        else if (arg == "--max-threads")
+        {
+            options.max_threads = std::max<size_t>(std::stoull(value), 1);
+        }
+        else if (arg == "--degenerate-limit")
+        {
+            options.degenerate_limit = std::stoull(value);
+        }
+        else if (arg == "--linear-probes")
+        {
+            options.linear_probes = std::stoull(value);
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = std::stoull(value);
+        }
+        else if (arg == "--suite" && (value == "containers" || value == "splay" || value == "concurrent_tree" ||
+                                      value == "queue" || value == "skip_list"))
+        {
+            options.suite = value;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    result_writer writer(std::cout, options.format);
+    const auto selected = [&options](const char* suite) { return options.suite.empty() || options.suite == suite; };
+
+    if (selected("containers"))
+    {
+        run_container_suite<int>(writer, options);
+        run_container_suite<int64_t>(writer, options);
+        run_container_suite<std::string>(writer, options);
+    }
+    if (selected("splay"))
+    {
+        run_splay_suite(writer, options);
+    }
+    if (selected("concurrent_tree"))
+    {
+        run_concurrent_tree_suite(writer, options);
+    }
+    if (selected("queue"))
+    {
+        run_queue_suite(writer, options);
+    }
+    if (selected("skip_list"))
+    {
+        run_skip_list_suite(writer, options);
+    }
+
+    return 0;
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// number of the global operator new calls, counted by the replacement operators of the benchmark driver
+inline std::atomic<uint64_t>& allocation_count()
+{
+    static std::atomic<uint64_t> count{0};
+    return count;
+}
+
+// process peak resident set size in kilobytes (high-water mark since the start, not per benchmark case)
+inline uint64_t peak_rss_kb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // bytes on macOS, kilobytes everywhere else
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+// measures the time and the allocations of the operations between construction and stop()
+class measurement
+{
+public:
+    measurement()
+        : allocations_(allocation_count().load(std::memory_order_relaxed)), start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    void stop()
+    {
+        const auto end = std::chrono::steady_clock::now();
+        nanoseconds_ = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+        allocations_ = allocation_count().load(std::memory_order_relaxed) - allocations_;
+    }
+
+    double nanoseconds() const
+    {
+        return nanoseconds_;
+    }
+
+    uint64_t allocations() const
+    {
+        return allocations_;
+    }
+
+private:
+    uint64_t allocations_;
+    std::chrono::steady_clock::time_point start_;
+    double nanoseconds_ = 0;
+};
+
+// one line of the report
+struct benchmark_result
+{
+    std::string suite;
+    std::string container;
+    std::string operation;
+    std::string key_type;
+    std::string order;
+    size_t size;
+    size_t threads;
+    size_t operations;
+    double ns_per_op;
+    double allocations_per_op;
+    uint64_t peak_rss_kb;
+};
+
+// writes the results as CSV or as a JSON array, one result per line, as soon as they are produced
+class result_writer
+{
+public:
+    enum class format { csv, json };
+
+    result_writer(std::ostream& os, const format output_format) : os_(os), format_(output_format), count_(0)
+    {
+        if (format_ == format::csv)
+        {
+            os_ << "suite,container,operation,key_type,order,size,threads,operations,ns_per_op,allocations_per_op,"
+                   "peak_rss_kb\n";
+        }
+        else
+        {
+            os_ << "[\n";
+        }
+    }
+
+    result_writer(const result_writer& other) = delete;
+    result_writer& operator=(const result_writer& other) = delete;
+
+    void write(const benchmark_result& result)
+    {
+        char numbers[128];
+        if (format_ == format::csv)
+        {
+            std::snprintf(numbers, sizeof(numbers), "%zu,%zu,%zu,%.3f,%.4f,%llu", result.size, result.threads,
+                          result.operations, result.ns_per_op, result.allocations_per_op,
+                          static_cast<unsigned long long>(result.peak_rss_kb));
+            os_ << result.suite << ',' << result.container << ',' << result.operation << ',' << result.key_type << ','
+                << result.order << ',' << numbers << '\n';
+        }
+        else
+        {
+            std::snprintf(numbers, sizeof(numbers),
+                          "\"size\": %zu, \"threads\": %zu, \"operations\": %zu, \"ns_per_op\": %.3f, "
+                          "\"allocations_per_op\": %.4f, \"peak_rss_kb\": %llu",
+                          result.size, result.threads, result.operations, result.ns_per_op, result.allocations_per_op,
+                          static_cast<unsigned long long>(result.peak_rss_kb));
+            os_ << (count_ > 0 ? ",\n" : "") << "  {\"suite\": \"" << result.suite << "\", \"container\": \""
+                << result.container << "\", \"operation\": \"" << result.operation << "\", \"key_type\": \""
+                << result.key_type << "\", \"order\": \"" << result.order << "\", " << numbers << '}';
+        }
+        os_.flush();
+        count_++;
+    }
+
+    ~result_writer()
+    {
+        if (format_ == format::json)
+        {
+            os_ << "\n]\n";
+        }
+    }
+
+private:
+    std::ostream& os_;
+    format format_;
+    size_t count_;
+};
+
+// zipfian ranks in [0, n): rank 0 is the most popular, popularity of rank i is proportional to 1 / (i + 1)^theta
+// the generator of Gray et al. "Quickly generating billion-record synthetic databases", O(n) setup, O(1) per value
+class zipf_generator
+{
+public:
+    zipf_generator(const uint64_t n, const double theta = 0.99)
+        : n_(n), theta_(theta), alpha_(1.0 / (1.0 - theta)), zeta_n_(zeta(n, theta)), uniform_(0.0, 1.0)
+    {
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta(2, theta) / zeta_n_);
+    }
+
+    template <typename Generator>
+    uint64_t operator()(Generator& generator)
+    {
+        const double u = uniform_(generator);
+        const double uz = u * zeta_n_;
+        if (uz < 1.0)
+        {
+            return 0;
+        }
+        if (uz < 1.0 + std::pow(0.5, theta_))
+        {
+            return std::min<uint64_t>(1, n_ - 1);
+        }
+        const auto rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(rank, n_ - 1);
+    }
+
+private:
+    static double zeta(const uint64_t n, const double theta)
+    {
+        double sum = 0;
+        for (uint64_t idx = 1; idx <= n; ++idx)
+        {
+            sum += 1.0 / std::pow(static_cast<double>(idx), theta);
+        }
+        return sum;
+    }
+
+    uint64_t n_;
+    double theta_;
+    double alpha_;
+    double zeta_n_;
+    double eta_;
+    std::uniform_real_distribution<double> uniform_;
+};
+
+// key orders of the workloads: sorted - 0..n-1, random - shuffled 0..n-1,
+// zipf - n draws of skewed ranks (with repeats), the ranks are scattered over the key space
+enum class key_order { sorted, random, zipf };
+
+inline const char* key_order_name(const key_order order)
+{
+    switch (order)
+    {
+    case key_order::sorted:
+        return "sorted";
+    case key_order::random:
+        return "random";
+    default:
+        return "zipf";
+    }
+}
+
+inline std::vector<uint64_t> make_key_indices(const size_t n, const key_order order, std::mt19937_64& generator)
+{
+    std::vector<uint64_t> indices(n);
+    std::iota(indices.begin(), indices.end(), 0);
+    if (order == key_order::random)
+    {
+        std::shuffle(indices.begin(), indices.end(), generator);
+    }
+    else if (order == key_order::zipf && n > 0)
+    {
+        std::vector<uint64_t> rank_to_key = indices;
+        std::shuffle(rank_to_key.begin(), rank_to_key.end(), generator);
+        zipf_generator zipf(n);
+        for (auto& index : indices)
+        {
+            index = rank_to_key[zipf(generator)];
+        }
+    }
+    return indices;
+}
+
+// maps the key index to the key of the given type, the mapping keeps the order of the indices
+template <typename T>
+T make_key(uint64_t index);
+
+template <>
+inline int make_key<int>(const uint64_t index)
+{
+    return static_cast<int>(index);
+}
+
+template <>
+inline int64_t make_key<int64_t>(const uint64_t index)
+{
+    // spread over the 64 bit range, still increasing
+    return static_cast<int64_t>(index * 2654435761ull);
+}
+
+template <>
+inline std::string make_key<std::string>(const uint64_t index)
+{
+    // zero padding keeps the lexicographic order numeric, 20 chars don't fit into the small string buffer
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "key:%016llu", static_cast<unsigned long long>(index));
+    return buffer;
+}
+
+template <typename T>
+const char* key_type_name();
+
+template <>
+inline const char* key_type_name<int>()
+{
+    return "int";
+}
+
+template <>
+inline const char* key_type_name<int64_t>()
+{
+    return "int64";
+}
+
+template <>
+inline const char* key_type_name<std::string>()
+{
+    return "string";
+}
+
+template <typename T>
+std::vector<T> make_keys(const std::vector<uint64_t>& indices)
+{
+    std::vector<T> keys;
+    keys.reserve(indices.size());
+    for (const uint64_t index : indices)
+    {
+        keys.push_back(make_key<T>(index));
+    }
+    return keys;
+}
+
+inline volatile uint64_t benchmark_sink = 0;
+
+// keeps the compiler from dropping the computations whose results are not used
+inline void do_not_optimize(const uint64_t checksum)
+{
+    benchmark_sink = checksum;
+}
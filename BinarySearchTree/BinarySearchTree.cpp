@@ -0,0 +1,700 @@
+// the driver checks the operation counters as well
+#define BST_ENABLE_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "binary_search_tree.h"
+#include "compact_binary_search_tree.h"
+#include "concurrent_binary_search_tree.h"
+#include "mapped_search_tree.h"
+#include "parallel_tree_algorithms.h"
+#include "persistent_binary_search_tree.h"
+#include "weight_balanced_tree.h"
+
+// less that records the threads it was called from
+struct thread_recording_less
+{
+    bool operator()(const int l, const int r) const
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        threads().insert(std::this_thread::get_id());
+        return l < r;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex threads_mutex;
+        return threads_mutex;
+    }
+
+    static std::set<std::thread::id>& threads()
+    {
+        static std::set<std::thread::id> called_from;
+        return called_from;
+    }
+};
+
+// key whose copy throws on demand
+struct throwing_key
+{
+    explicit throwing_key(const int key_value) : value(key_value)
+    {
+    }
+
+    throwing_key(const throwing_key& other) : value(other.value)
+    {
+        if (throw_on_copy)
+        {
+            throw std::runtime_error("copy failed");
+        }
+    }
+
+    bool operator<(const throwing_key& other) const
+    {
+        return value < other.value;
+    }
+
+    int value;
+    static bool throw_on_copy;
+};
+
+bool throwing_key::throw_on_copy = false;
+
+// number of the failed checks, main returns nonzero if there are any
+int failed_checks = 0;
+
+void report(const std::string& name, const bool passed)
+{
+    std::cout << name << ": " << (passed ? "passed" : "FAILED") << std::endl;
+    failed_checks += passed ? 0 : 1;
+}
+
+// adds count random values from [0, 4 * count) to the tree and to the reference set,
+// returns false if add disagrees with the set about the duplicates
+template <typename Tree>
+bool fill_random(Tree& tree, std::set<int>& reference, const int count, const unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> distribution(0, count * 4 - 1);
+    bool passed = true;
+    for (int idx = 0; idx < count; ++idx)
+    {
+        const int value = distribution(random);
+        passed = passed && tree.add(value) == reference.insert(value).second;
+    }
+    return passed && tree.size() == reference.size();
+}
+
+// rank, select, count_range and the bounds agree with std::set, also after the removals
+bool check_order_statistics()
+{
+    constexpr int count = 2000;
+    binary_search_tree<int> tree;
+    std::set<int> reference;
+    bool passed = fill_random(tree, reference, count, 1);
+    std::mt19937 random(2);
+    for (int idx = 0; idx < count / 4; ++idx)
+    {
+        const int value = static_cast<int>(random() % (count * 4));
+        passed = passed && tree.remove(value) == (reference.erase(value) == 1);
+    }
+    passed = passed && tree.size() == reference.size() && tree.root()->subtree_size() == reference.size();
+
+    size_t idx = 0;
+    for (const int value : reference)
+    {
+        passed = passed && tree.select(idx) && tree.select(idx)->get() == value;
+        ++idx;
+    }
+    passed = passed && !tree.select(reference.size());
+
+    for (int value = -1; value <= count * 4; ++value)
+    {
+        const auto lower = reference.lower_bound(value);
+        const auto upper = reference.upper_bound(value);
+        passed = passed && tree.rank(value) == static_cast<size_t>(std::distance(reference.begin(), lower));
+        passed = passed && tree.count_range(value, value + 37) ==
+                               static_cast<size_t>(std::distance(lower, reference.lower_bound(value + 37)));
+
+        auto tree_lower = tree.lower_bound(value);
+        auto tree_upper = tree.upper_bound(value);
+        passed = passed && (lower == reference.end() ? tree_lower == tree.end_inorder() : *tree_lower == *lower);
+        passed = passed && (upper == reference.end() ? tree_upper == tree.end_inorder() : *tree_upper == *upper);
+
+        // the iteration started at the bound goes on to the end in order
+        if (value % 97 == 0)
+        {
+            auto expected = upper;
+            for (; tree_upper != tree.end_inorder() && expected != reference.end(); ++tree_upper, ++expected)
+            {
+                passed = passed && *tree_upper == *expected;
+            }
+            passed = passed && tree_upper == tree.end_inorder() && expected == reference.end();
+        }
+    }
+    return passed && tree.count_range(10, 10) == 0 && tree.count_range(10, 5) == 0;
+}
+
+// the set operations on inputs above the parallel threshold must not use more than 2^fork_depth threads
+bool check_set_operation_fork_depth()
+{
+    using tree = weight_balanced_tree<int, thread_recording_less>;
+    const int count = static_cast<int>(tree::parallel_threshold) * 4;
+
+    bool passed = true;
+    for (const size_t fork_depth : {0, 1})
+    {
+        tree evens, odds;
+        for (int value = 0; value < count; value += 2)
+        {
+            evens.add(value);
+            odds.add(value + 1);
+        }
+
+        thread_recording_less::threads().clear();
+        tree united = tree::set_union(std::move(evens), std::move(odds), fork_depth);
+        const size_t threads_used = thread_recording_less::threads().size();
+
+        int expected = 0;
+        for (auto elem = united.begin_inorder(); elem != united.end_inorder(); ++elem)
+        {
+            passed = passed && *elem == expected++;
+        }
+        passed = passed && expected == count && threads_used <= (size_t{1} << fork_depth);
+    }
+    return passed;
+}
+
+// the set operations follow the order of the comparator
+bool check_set_operation_comparator()
+{
+    using tree = weight_balanced_tree<int, std::greater<int>>;
+    tree left, right;
+    for (int value = 0; value < 100; ++value)
+    {
+        left.add(value);
+        right.add(value + 50);
+    }
+
+    const tree common = tree::set_intersection(left, right);
+    const tree rest = tree::set_difference(left, right);
+    bool passed = common.size() == 50 && rest.size() == 50 && left.contains(0) && !left.contains(100);
+
+    int expected = 99;
+    for (auto elem = common.begin_inorder(); elem != common.end_inorder(); ++elem)
+    {
+        passed = passed && *elem == expected--;
+    }
+    return passed && expected == 49;
+}
+
+// readers never miss the values that stay in the tree while writers add and remove the other values
+// (the removed nodes with two children stay in the tree as routing nodes and are unlinked later)
+bool check_concurrent_tree_stress()
+{
+    constexpr int stable_count = 2000;
+    constexpr int readers = 3;
+    constexpr int writers = 2;
+    constexpr int rounds = 20;
+
+    // even values stay in the tree, odd ones come and go, random order gives nodes with two children
+    std::vector<int> values;
+    for (int value = 0; value < stable_count * 2; ++value)
+    {
+        values.push_back(value);
+    }
+    std::mt19937 random(42);
+    std::shuffle(values.begin(), values.end(), random);
+
+    concurrent_binary_search_tree<int> tree;
+    for (const int value : values)
+    {
+        tree.add(value);
+    }
+
+    std::atomic<int> writers_left(writers);
+    std::atomic<size_t> false_negatives(0);
+    std::vector<std::thread> threads;
+    for (int reader = 0; reader < readers; ++reader)
+    {
+        threads.emplace_back([&tree, &writers_left, &false_negatives] {
+            while (writers_left.load() > 0)
+            {
+                for (int value = 0; value < stable_count * 2; value += 2)
+                {
+                    if (!tree.contains(value))
+                    {
+                        false_negatives.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+
+    // every writer owns its own odd values, the last round leaves them removed
+    for (int writer = 0; writer < writers; ++writer)
+    {
+        threads.emplace_back([&tree, &writers_left, values, writer]() mutable {
+            std::mt19937 writer_random(writer);
+            for (int round = 0; round < rounds; ++round)
+            {
+                std::shuffle(values.begin(), values.end(), writer_random);
+                for (const int value : values)
+                {
+                    if (value % 2 == 1 && value / 2 % writers == writer)
+                    {
+                        tree.add(value);
+                    }
+                }
+                for (const int value : values)
+                {
+                    if (value % 2 == 1 && value / 2 % writers == writer)
+                    {
+                        tree.remove(value);
+                    }
+                }
+            }
+            writers_left.fetch_sub(1);
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    int expected = 0;
+    bool ordered = true;
+    tree.for_each_inorder([&expected, &ordered](const int value) {
+        ordered = ordered && value == expected;
+        expected += 2;
+    });
+    return false_negatives.load() == 0 && ordered && expected == stable_count * 2 &&
+           tree.size() == static_cast<size_t>(stable_count);
+}
+
+// a value constructor that throws during add leaves the subtree sizes (and so rank and select) intact
+bool check_add_exception_safety()
+{
+    binary_search_tree<throwing_key> tree;
+    for (const int value : {50, 25, 75, 10, 30, 60, 90})
+    {
+        tree.add(throwing_key(value));
+    }
+
+    // new values at the inner, the rightmost and the leftmost places
+    bool passed = true;
+    for (const int value : {27, 95, 5})
+    {
+        const throwing_key key(value);
+        throwing_key::throw_on_copy = true;
+        try
+        {
+            tree.add(key);
+            passed = false;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+        throwing_key::throw_on_copy = false;
+    }
+
+    const int sorted[] = {10, 25, 30, 50, 60, 75, 90};
+    passed = passed && tree.size() == 7 && tree.root()->subtree_size() == 7;
+    for (size_t idx = 0; idx < 7; ++idx)
+    {
+        passed = passed && tree.select(idx)->get().value == sorted[idx] &&
+                 tree.rank(throwing_key(sorted[idx])) == idx;
+    }
+    return passed && !tree.select(7) && tree.count_range(throwing_key(0), throwing_key(100)) == 7;
+}
+
+// every operation counts its own walk once, the walks that only fix up the subtree sizes are not counted
+bool check_operation_counters()
+{
+    binary_search_tree<int> tree;
+    for (const int value : {50, 25, 75})
+    {
+        tree.add(value);
+    }
+    tree.reset_operation_counters();
+
+    // 50 (one comparison to go left), 25 (two comparisons to find the match)
+    tree.remove(25);
+    // match at the root
+    tree.add(50);
+    const std::vector<int> no_keys;
+    std::vector<bool> results;
+    tree.contains_batch(no_keys.begin(), no_keys.end(), std::back_inserter(results));
+
+    const bst_stats stats = tree.stats();
+    return stats.remove.calls == 1 && stats.remove.comparisons == 3 && stats.remove.nodes_visited == 2 &&
+           stats.add.calls == 1 && stats.add.comparisons == 2 && stats.add.nodes_visited == 1 &&
+           stats.find.calls == 0 && results.empty();
+}
+
+// runs func on a thread with a small stack, so the deep recursion crashes right away
+// (falls back to the calling thread where the stack size can't be set)
+template <typename Func>
+void run_with_small_stack(Func func)
+{
+#ifdef _WIN32
+    func();
+#else
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, 256 * 1024);
+    pthread_t thread;
+    auto body = [](void* arg) -> void* {
+        (*static_cast<Func*>(arg))();
+        return nullptr;
+    };
+    if (pthread_create(&thread, &attributes, body, &func) == 0)
+    {
+        pthread_join(thread, nullptr);
+    }
+    else
+    {
+        func();
+    }
+    pthread_attr_destroy(&attributes);
+#endif
+}
+
+// sorted values make the persistent tree a chain, freeing its versions must not recurse once per level
+bool check_persistent_tree_deep_chain()
+{
+    constexpr int depth = 5000;
+    bool passed = false;
+    run_with_small_stack([&passed] {
+        persistent_binary_search_tree<int> tree;
+        for (int value = 0; value < depth; ++value)
+        {
+            tree.add(value);
+        }
+        persistent_binary_search_tree<int> old_version = tree.snapshot();
+        tree.remove(0);
+        passed = tree.size() == depth - 1 && old_version.contains(0) && !tree.contains(0);
+        old_version.clear();
+        tree.clear();
+        passed = passed && tree.size() == 0;
+    });
+    return passed;
+}
+
+// find_batch and contains_batch give the same answers as std::set for the keys in any order,
+// present, missing and repeated ones, in batches shorter and longer than a search group
+bool check_find_batch()
+{
+    constexpr int count = 3000;
+    binary_search_tree<int> tree;
+    std::set<int> reference;
+    bool passed = fill_random(tree, reference, count, 3);
+
+    std::vector<int> keys;
+    for (int value = -5; value < count * 4 + 5; value += 3)
+    {
+        keys.push_back(value);
+    }
+    keys.push_back(keys.front());
+    keys.push_back(*reference.begin());
+    std::mt19937 random(4);
+    std::shuffle(keys.begin(), keys.end(), random);
+
+    for (const size_t batch : {size_t{1}, size_t{5}, keys.size()})
+    {
+        for (size_t first = 0; first < keys.size(); first += batch)
+        {
+            const size_t last = std::min(first + batch, keys.size());
+            std::vector<bst_node<int>*> found;
+            std::vector<bool> contained;
+            tree.find_batch(keys.begin() + first, keys.begin() + last, std::back_inserter(found));
+            tree.contains_batch(keys.begin() + first, keys.begin() + last, std::back_inserter(contained));
+            passed = passed && found.size() == last - first && contained.size() == last - first;
+            for (size_t idx = 0; passed && idx < found.size(); ++idx)
+            {
+                const bool expected = reference.count(keys[first + idx]) == 1;
+                passed = contained[idx] == expected && (found[idx] != nullptr) == expected &&
+                         (!found[idx] || found[idx]->get() == keys[first + idx]);
+            }
+        }
+    }
+    return passed;
+}
+
+// the inorder walk gives the values of the reference and the subtree sizes are right at every index
+bool matches_reference(const binary_search_tree<int>& tree, const std::set<int>& reference)
+{
+    bool passed = tree.size() == reference.size() &&
+                  (reference.empty() ? !tree.root() : tree.root()->subtree_size() == reference.size());
+    auto expected = reference.begin();
+    size_t idx = 0;
+    for (auto elem = tree.begin_inorder(); elem != tree.end_inorder(); ++elem, ++expected, ++idx)
+    {
+        passed = passed && expected != reference.end() && *elem == *expected && tree.select(idx) &&
+                 tree.select(idx)->get() == *expected;
+        if (!passed)
+        {
+            return false;
+        }
+    }
+    return passed && expected == reference.end();
+}
+
+// the splay and semi-splay finds reshape the tree without losing values or breaking the subtree sizes,
+// a splayed value ends up in the root
+bool check_access_adaptation()
+{
+    using adaptation = binary_search_tree<int>::access_adaptation;
+    constexpr int count = 2000;
+
+    bool passed = true;
+    for (const adaptation mode : {adaptation::splay, adaptation::semi_splay})
+    {
+        binary_search_tree<int> tree;
+        std::set<int> reference;
+        passed = passed && fill_random(tree, reference, count, 5);
+        tree.set_access_adaptation(mode);
+
+        std::mt19937 random(6);
+        std::uniform_int_distribution<int> distribution(0, count * 4 - 1);
+        for (int step = 0; step < count * 5; ++step)
+        {
+            // mostly finds, with a hot set of small values to make the paths repeat
+            const int value = step % 3 == 0 ? distribution(random) % 64 : distribution(random);
+            switch (step % 5)
+            {
+            case 0:
+                passed = passed && tree.add(value) == reference.insert(value).second;
+                break;
+            case 1:
+                passed = passed && tree.remove(value) == (reference.erase(value) == 1);
+                break;
+            default:
+            {
+                const bst_node<int>* found = tree.find(value);
+                const bool expected = reference.count(value) == 1;
+                passed = passed && (found != nullptr) == expected && (!found || found->get() == value);
+                passed = passed && (mode != adaptation::splay || !found || tree.root() == found);
+                break;
+            }
+            }
+        }
+        passed = passed && matches_reference(tree, reference);
+    }
+    return passed;
+}
+
+// save and load give back the same tree, the mapped view of the file finds the same keys as std::set,
+// the empty tree round-trips and a truncated file is rejected by both readers
+bool check_save_load()
+{
+    constexpr int count = 3000;
+    const std::string path = "bst_check.bin";
+    binary_search_tree<int> tree;
+    std::set<int> reference;
+    bool passed = fill_random(tree, reference, count, 7);
+
+    tree.save(path);
+    passed = passed && matches_reference(binary_search_tree<int>::load(path), reference);
+    {
+        const mapped_search_tree<int> mapped(path);
+        passed = passed && mapped.size() == reference.size() &&
+                 std::equal(mapped.begin(), mapped.end(), reference.begin(), reference.end());
+        for (int value = -1; value <= count * 4; ++value)
+        {
+            const int* found = mapped.find(value);
+            passed = passed && (found != nullptr) == (reference.count(value) == 1) && (!found || *found == value);
+        }
+    }
+
+    binary_search_tree<int>().save(path);
+    passed = passed && binary_search_tree<int>::load(path).size() == 0;
+    {
+        const mapped_search_tree<int> mapped(path);
+        passed = passed && mapped.size() == 0 && !mapped.contains(0);
+    }
+
+    {
+        std::ofstream truncated(path, std::ios::binary | std::ios::trunc);
+        truncated << "bst";
+    }
+    for (int reader = 0; reader < 2; ++reader)
+    {
+        try
+        {
+            if (reader == 0)
+            {
+                binary_search_tree<int>::load(path);
+            }
+            else
+            {
+                mapped_search_tree<int> mapped(path);
+            }
+            passed = false;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+    std::remove(path.c_str());
+    return passed;
+}
+
+// parallel_export and parallel_reduce give the values in the order of std::set and parallel_for_each
+// visits each of them once, for a random tree and a chain, both big enough to be cut into many pieces
+bool check_parallel_algorithms()
+{
+    constexpr int count = 40000;
+    constexpr int chain_length = 6000;
+    thread_pool pool(4);
+
+    std::vector<std::pair<binary_search_tree<int>, std::set<int>>> cases(2);
+    bool passed = fill_random(cases[0].first, cases[0].second, count, 8);
+    for (int value = 0; value < chain_length; ++value)
+    {
+        cases[1].first.add(value);
+        cases[1].second.insert(value);
+    }
+    // the empty tree has no pieces at all
+    cases.emplace_back();
+
+    for (const auto& test_case : cases)
+    {
+        const binary_search_tree<int>& tree = test_case.first;
+        const std::vector<int> expected(test_case.second.begin(), test_case.second.end());
+
+        std::vector<int> exported(tree.size(), -1);
+        passed = passed && parallel_export(tree, exported.begin(), pool) == exported.end() && exported == expected;
+
+        // concatenation is associative but not commutative, so the pieces have to be combined in order
+        const std::vector<int> reduced = parallel_reduce(
+            tree, std::vector<int>(), [](const int value) { return std::vector<int>{value}; },
+            [](std::vector<int> l, const std::vector<int>& r)
+            {
+                l.insert(l.end(), r.begin(), r.end());
+                return l;
+            },
+            pool);
+        passed = passed && reduced == expected;
+
+        std::atomic<size_t> visited(0);
+        std::atomic<long long> sum(0);
+        parallel_for_each(
+            tree,
+            [&visited, &sum](const int value)
+            {
+                visited.fetch_add(1);
+                sum.fetch_add(value);
+            });
+        long long expected_sum = 0;
+        for (const int value : expected)
+        {
+            expected_sum += value;
+        }
+        passed = passed && visited.load() == expected.size() && sum.load() == expected_sum;
+    }
+    return passed;
+}
+
+// the inorder walk and find of the compact tree agree with std::set
+bool matches_reference(const compact_binary_search_tree<int>& tree, const std::set<int>& reference)
+{
+    bool passed = tree.size() == reference.size();
+    auto expected = reference.begin();
+    for (auto elem = tree.begin_inorder(); passed && elem != tree.end_inorder(); ++elem, ++expected)
+    {
+        passed = expected != reference.end() && *elem == *expected;
+    }
+    passed = passed && expected == reference.end();
+    const int last = reference.empty() ? 0 : *reference.rbegin();
+    for (int value = -1; passed && value <= last + 1; ++value)
+    {
+        const int* found = tree.find(value);
+        passed = (found != nullptr) == (reference.count(value) == 1) && (!found || *found == value);
+    }
+    return passed;
+}
+
+// the compact tree keeps the values of std::set through the removals, both compaction layouts and the changes
+// after the compaction; the freed slots are reused and the inorder layout puts the slots in the sorted order
+bool check_compact_tree()
+{
+    using tree_type = compact_binary_search_tree<int>;
+    constexpr int count = 3000;
+
+    bool passed = true;
+    for (const tree_type::node_layout layout : {tree_type::node_layout::inorder, tree_type::node_layout::van_emde_boas})
+    {
+        tree_type tree;
+        std::set<int> reference;
+        passed = passed && fill_random(tree, reference, count, 9);
+
+        std::mt19937 random(10);
+        for (int idx = 0; idx < count; ++idx)
+        {
+            const int value = static_cast<int>(random() % (count * 4));
+            passed = passed && tree.remove(value) == (reference.erase(value) == 1);
+        }
+        passed = passed && matches_reference(tree, reference);
+
+        tree.compact(layout);
+        passed = passed && tree.capacity() == reference.size() && matches_reference(tree, reference);
+        if (layout == tree_type::node_layout::inorder)
+        {
+            uint32_t expected_slot = 0;
+            for (auto elem = tree.begin_inorder(); elem != tree.end_inorder(); ++elem)
+            {
+                passed = passed && elem.slot() == expected_slot++;
+            }
+        }
+
+        // a removal followed by an add takes the freed slot instead of growing the arrays
+        for (int idx = 0; idx < count / 4; ++idx)
+        {
+            const int removed = *std::next(reference.begin(), static_cast<long>(random() % reference.size()));
+            const int added = static_cast<int>(random() % (count * 4)) + count * 4;
+            passed = passed && tree.remove(removed) && reference.erase(removed) == 1;
+            passed = passed && tree.add(added) == reference.insert(added).second;
+        }
+        passed = passed && tree.capacity() <= reference.size() + count / 4 && matches_reference(tree, reference);
+    }
+
+    tree_type empty;
+    empty.compact();
+    return passed && empty.size() == 0 && empty.begin_inorder() == empty.end_inorder() && !empty.contains(0);
+}
+
+int main()
+{
+    report("Weight balanced tree set operations respect the fork depth", check_set_operation_fork_depth());
+    report("Weight balanced tree set operations use the comparator", check_set_operation_comparator());
+    report("Concurrent tree readers see the stable values during the writes", check_concurrent_tree_stress());
+    report("Persistent tree frees deep versions without recursion", check_persistent_tree_deep_chain());
+    report("Failed add keeps the subtree sizes", check_add_exception_safety());
+    report("Operation counters count every walk once", check_operation_counters());
+    report("Rank, select, count_range and bounds match std::set", check_order_statistics());
+    report("Batched search matches std::set", check_find_batch());
+    report("Splay and semi-splay finds keep the tree consistent", check_access_adaptation());
+    report("Saved tree loads and maps back with the same keys", check_save_load());
+    report("Parallel export, reduce and for_each match std::set", check_parallel_algorithms());
+    report("Compact tree matches std::set before and after compaction", check_compact_tree());
+    return failed_checks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,17 +1,43 @@
 #pragma once
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <stack>
-
-template <typename T>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Common/allocation_accounting.h"
+#include "../Common/prefetch.h"
+#include "bst_file_format.h"
+#include "bst_stats.h"
+
+// counts the comparisons and visited nodes of the enclosing operation in given counters (see bst_stats.h)
+#ifdef BST_ENABLE_STATS
+#define BST_STATS_OPERATION(counters) const operation_scope stats_operation_scope_(counters)
+#else
+#define BST_STATS_OPERATION(counters)
+#endif
+
+template <typename T, typename Compare = std::less<T>>
 class binary_search_tree;
 
+template <typename T, typename Compare = std::less<T>>
+class weight_balanced_tree;
+
 template <typename T>
 class bst_node
 {
-    // allowing private access to the binary_search_tree
-    friend class binary_search_tree<T>;
+    // allowing private access to the trees built from these nodes
+    template <typename, typename>
+    friend class binary_search_tree;
+    template <typename, typename>
+    friend class weight_balanced_tree;
 
 public:
-    T get() const
+    const T& get() const
     {
         return value_;
     }
@@ -26,26 +52,57 @@ public:
         return right_;
     }
 
+    // number of nodes in the subtree rooted at this node (including the node itself)
+    size_t subtree_size() const
+    {
+        return subtree_size_;
+    }
+
 private:
     // don't allow to create a node outside of the binary_search_tree
-    bst_node(const T& value) : value_(value), left_(nullptr), right_(nullptr)
+    bst_node(const T& value) : value_(value), left_(nullptr), right_(nullptr), subtree_size_(1)
+    {
+    }
+
+    bst_node(T&& value) : value_(std::move(value)), left_(nullptr), right_(nullptr), subtree_size_(1)
+    {
+    }
+
+    // constructs the value in place from the arguments of its constructor
+    template <typename... Args>
+    explicit bst_node(std::in_place_t, Args&&... args)
+        : value_(std::forward<Args>(args)...), left_(nullptr), right_(nullptr), subtree_size_(1)
     {
     }
 
     T value_;
     bst_node* left_;
     bst_node* right_;
+    size_t subtree_size_;
 };
 
-template <typename T>
+// Compare defines the order of the values (std::less by default), values are equal if neither is less
+// than the other; a transparent comparator (e.g. std::less<>) enables lookups by keys of other types
+template <typename T, typename Compare>
 class binary_search_tree
 {
 public:
-    binary_search_tree() : root_(nullptr), size_(0)
+    // self-adjusting modes of find: accessed nodes are moved towards the root, so hot values become cheap
+    // splay - the node is rotated up to the root
+    // semi_splay - the node is lifted roughly halfway up, which takes about half of the rotations (link writes)
+    enum class access_adaptation { none, splay, semi_splay };
+
+    binary_search_tree() : root_(nullptr), size_(0), adaptation_(access_adaptation::none)
+    {
+    }
+
+    explicit binary_search_tree(const Compare& comparator)
+        : root_(nullptr), size_(0), adaptation_(access_adaptation::none), comparator_(comparator)
     {
     }
 
-    binary_search_tree(const binary_search_tree& other) : root_(nullptr), size_(0)
+    binary_search_tree(const binary_search_tree& other)
+        : root_(nullptr), size_(0), adaptation_(other.adaptation_), comparator_(other.comparator_)
     {
         for (auto elem = other.begin_preorder(); elem != other.end_preorder(); ++elem)
         {
@@ -53,8 +110,12 @@ public:
         }
     }
 
-    binary_search_tree(const binary_search_tree&& other) noexcept : root_(other.root_), size_(other.size_)
+    binary_search_tree(binary_search_tree&& other) noexcept
+        : root_(other.root_), size_(other.size_), adaptation_(other.adaptation_), comparator_(other.comparator_)
     {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.transfer_from(other.allocations_, size_ * sizeof(bst_node<T>));
+#endif
         other.root_ = nullptr;
         other.size_ = 0;
     }
@@ -64,37 +125,53 @@ public:
         return root_;
     }
 
-    void add(const T& value)
+    // returns false if the value is already in the tree (the value is not copied in that case)
+    bool add(const T& value)
     {
-        // double pointer for delayed access to the pointer for creation in the end of the method
-        // covering special case for root creation
-        bst_node<T>** current = &root_;
-        // iterate through the tree until empty pointer in the correct place is found
-        while (*current)
-        {
-            // ignore duplicate values
-            if (value == (*current)->get())
-            {
-                return;
-            }
+        BST_STATS_OPERATION(add_counters_);
+        return add_value(value);
+    }
 
-            // right - greater values, left - lower values
-            if (value > (*current)->get())
-            {
-                current = &(*current)->right_;
-            }
-            else
-            {
-                current = &(*current)->left_;
-            }
+    bool add(T&& value)
+    {
+        BST_STATS_OPERATION(add_counters_);
+        return add_value(std::move(value));
+    }
+
+    // constructs the value in the node from args, the node is dropped if such value is already in the tree
+    template <typename... Args>
+    bool emplace(Args&&... args)
+    {
+        BST_STATS_OPERATION(add_counters_);
+        auto* node = create_node(std::in_place, std::forward<Args>(args)...);
+        bst_node<T>** slot = find_insert_slot(node->value_);
+        if (!slot)
+        {
+            destroy_node(node);
+            return false;
         }
-        *current = new bst_node<T>(value);
+        *slot = node;
         size_++;
+        return true;
+    }
+
+    // find in the non-const tree adapts the tree to the access pattern if adaptation is enabled
+    // (this changes the shape, so iterators created before are invalidated)
+    bst_node<T>* find(const T& value)
+    {
+        BST_STATS_OPERATION(find_counters_);
+        return find_adaptive(value);
     }
 
     bst_node<T>* find(const T& value) const
     {
-        return find_with_parent_(value).target;
+        BST_STATS_OPERATION(find_counters_);
+        return find_with_parent(value).target;
+    }
+
+    bool contains(const T& value)
+    {
+        return find(value) != nullptr;
     }
 
     bool contains(const T& value) const
@@ -102,15 +179,75 @@ public:
         return find(value) != nullptr;
     }
 
+    // heterogeneous lookup: available with a transparent comparator, key is compared with values directly
+    // (e.g. std::string_view in the tree of std::string without creating a string)
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bst_node<T>* find(const K& key)
+    {
+        BST_STATS_OPERATION(find_counters_);
+        return find_adaptive(key);
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bst_node<T>* find(const K& key) const
+    {
+        BST_STATS_OPERATION(find_counters_);
+        return find_with_parent(key).target;
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& key)
+    {
+        return find(key) != nullptr;
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    // adaptation can be turned off for read-mostly phases, the current shape is kept as it is
+    void set_access_adaptation(const access_adaptation adaptation)
+    {
+        adaptation_ = adaptation;
+    }
+
+    access_adaptation get_access_adaptation() const
+    {
+        return adaptation_;
+    }
+
+    // finds every key of the range and writes the found node (or nullptr) to out, in the order of the keys
+    // searches are advanced level by level in groups and the next node of each search is prefetched
+    // before it's touched, so the cache misses of the whole group overlap instead of being paid one by one
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt keys_begin, ForwardIt keys_end, OutputIt out) const
+    {
+        return search_batch(keys_begin, keys_end, out, [](bst_node<T>* node) { return node; });
+    }
+
+    // same as find_batch, but writes whether the tree contains the key
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_batch(ForwardIt keys_begin, ForwardIt keys_end, OutputIt out) const
+    {
+        return search_batch(keys_begin, keys_end, out, [](bst_node<T>* node) { return node != nullptr; });
+    }
+
     void clear()
     {
-        delete root_;
+        // children are visited before their parent, so every node is deleted after its subtree
+        for (auto elem = begin_postorder(); elem != end_postorder(); ++elem)
+        {
+            clear_children_and_delete_node(elem.get_node());
+        }
         root_ = nullptr;
         size_ = 0;
     }
 
     bool remove(const T& value)
     {
+        BST_STATS_OPERATION(remove_counters_);
         search_result delete_result = find_with_parent(value);
 
         // nothing found
@@ -119,6 +256,9 @@ public:
             return false;
         }
 
+        // every ancestor of the deleting node loses one descendant
+        shrink_subtree_sizes_on_path(value);
+
         // identify type of node by children count to determine the right delete method to use
         switch (check_node_type(delete_result))
         {
@@ -146,13 +286,213 @@ public:
         return size_;
     }
 
-    ~binary_search_tree()
+    // STATS
+    // walks the whole tree to measure its shape, O(n)
+    // the operation counters are zero unless BST_ENABLE_STATS is defined
+    bst_stats stats() const
     {
-        // deleting root node triggers recursive tree delete
-        for (auto elem = begin_postorder(); elem != end_postorder(); ++elem)
+        bst_stats result;
+        result.size = size_;
+
+        // level by level traversal, summing up the depths of all nodes
+        std::vector<bst_node<T>*> level;
+        std::vector<bst_node<T>*> next_level;
+        size_t total_path = 0;
+        if (root_)
         {
-            clear_children_and_delete_node(elem.get_node());
+            level.push_back(root_);
         }
+        while (!level.empty())
+        {
+            result.nodes_per_level.push_back(level.size());
+            total_path += level.size() * result.nodes_per_level.size();
+            for (bst_node<T>* node : level)
+            {
+                if (node->left_)
+                {
+                    next_level.push_back(node->left_);
+                }
+                if (node->right_)
+                {
+                    next_level.push_back(node->right_);
+                }
+            }
+            level.swap(next_level);
+            next_level.clear();
+        }
+
+        result.height = result.nodes_per_level.size();
+        result.max_search_path = result.height;
+        result.average_search_path = size_ ? static_cast<double>(total_path) / size_ : 0;
+#ifdef BST_ENABLE_STATS
+        result.find = find_counters_.load();
+        result.add = add_counters_.load();
+        result.remove = remove_counters_.load();
+#endif
+        return result;
+    }
+
+    void reset_operation_counters()
+    {
+#ifdef BST_ENABLE_STATS
+        find_counters_.reset();
+        add_counters_.reset();
+        remove_counters_.reset();
+#endif
+    }
+
+    // memory of the nodes of this tree (see allocation_accounting.h), empty when accounting is compiled out
+    allocation_stats allocations() const
+    {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        return allocations_.stats();
+#else
+        return allocation_stats();
+#endif
+    }
+
+    // ORDER STATISTICS
+    // number of elements in the tree that are lower than value
+    size_t rank(const T& value) const
+    {
+        size_t result = 0;
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            // current node and its whole left subtree are lower than value
+            if (comparator_(current->value_, value))
+            {
+                result += subtree_size_of(current->left_) + 1;
+                current = current->right_;
+            }
+            else
+            {
+                current = current->left_;
+            }
+        }
+        return result;
+    }
+
+    // k-th smallest element of the tree (zero-based), nullptr if there are not enough elements
+    bst_node<T>* select(size_t k) const
+    {
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            const size_t left_size = subtree_size_of(current->left_);
+            if (k == left_size)
+            {
+                return current;
+            }
+
+            // skip the left subtree and the current node if k is beyond them
+            if (k > left_size)
+            {
+                k -= left_size + 1;
+                current = current->right_;
+            }
+            else
+            {
+                current = current->left_;
+            }
+        }
+        return nullptr;
+    }
+
+    // number of elements in range [lo, hi)
+    size_t count_range(const T& lo, const T& hi) const
+    {
+        if (!comparator_(lo, hi))
+        {
+            return 0;
+        }
+        return rank(hi) - rank(lo);
+    }
+
+    // SERIALIZATION
+    // writes the keys in sorted order in the binary format (see bst_file_format.h)
+    // the order is the one of Compare, so mapped_search_tree has to be opened with the same comparator
+    void save(const std::string& path) const
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Binary serialization requires trivially copyable keys");
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error("Couldn't save the tree: unable to open " + path);
+        }
+
+        const bst_file_header header = bst_file_header::make(sizeof(T), size_);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        const std::vector<char> padding(header.keys_offset - sizeof(header), 0);
+        file.write(padding.data(), padding.size());
+
+        // keys are written in big blocks instead of one by one
+        std::vector<T> block;
+        block.reserve(serialization_block_size);
+        for (auto elem = begin_inorder(); elem != end_inorder(); ++elem)
+        {
+            block.push_back(*elem);
+            if (block.size() == serialization_block_size)
+            {
+                file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+                block.clear();
+            }
+        }
+        file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+
+        if (!file)
+        {
+            throw std::runtime_error("Couldn't save the tree: write to " + path + " failed");
+        }
+    }
+
+    // reads the file written by save and builds a perfectly balanced tree in O(n)
+    static binary_search_tree load(const std::string& path)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Binary serialization requires trivially copyable keys");
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to open " + path);
+        }
+        const auto file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        bst_file_header header{};
+        if (file_size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            throw std::runtime_error("Couldn't load the tree: file is truncated or corrupted");
+        }
+        header.validate(sizeof(T), file_size);
+
+        std::vector<T> keys(header.key_count);
+        file.seekg(static_cast<std::streamoff>(header.keys_offset));
+        if (!file.read(reinterpret_cast<char*>(keys.data()), keys.size() * sizeof(T)))
+        {
+            throw std::runtime_error("Couldn't load the tree: file is truncated or corrupted");
+        }
+
+        binary_search_tree tree;
+
+        // the balanced build is valid only for strictly increasing keys
+        for (size_t idx = 1; idx < keys.size(); ++idx)
+        {
+            if (!tree.comparator_(keys[idx - 1], keys[idx]))
+            {
+                throw std::runtime_error("Couldn't load the tree: keys are not sorted");
+            }
+        }
+
+        tree.root_ = tree.build_balanced(keys.data(), keys.size());
+        tree.size_ = keys.size();
+        return tree;
+    }
+
+    ~binary_search_tree()
+    {
+        clear();
     }
 
     // ITERATORS
@@ -215,6 +555,9 @@ public:
     // inorder iterator - ordered iteration from min to max
     class inorder_iterator final : public base_iterator<inorder_iterator>
     {
+        // allowing lower_bound and upper_bound to start the iteration in the middle of the tree
+        friend class binary_search_tree;
+
         using base_iterator<inorder_iterator>::current_;
         using base_iterator<inorder_iterator>::stack_;
         
@@ -236,7 +579,7 @@ public:
             // after the last iteration current_ will be nullptr
             if (!stack_.empty())
             {
-                current_ = stack_.top();
+                take_top();
             }
         }
 
@@ -250,20 +593,7 @@ public:
             // need to work further if stack is not empty
             if (!stack_.empty())
             {
-                // take the next element
-                current_ = stack_.top();
-                // if need to process right part of the subtree
-                if (current_->right_)
-                {
-                    // remove current element since it's saved in current_ field
-                    stack_.pop();
-                    // add right element and all it's left descendants to the stack
-                    stack_.push(current_->right_);
-                    while (stack_.top()->left_)
-                    {
-                        stack_.push(stack_.top()->left_);
-                    }
-                }
+                take_top();
             }
             // end of the iteration cycle
             else
@@ -272,6 +602,36 @@ public:
             }
             return *this;
         }
+
+    private:
+        // continue the iteration from the given stack of pending nodes (top is the current one)
+        explicit inorder_iterator(std::stack<bst_node<T>*>&& pending): base_iterator<inorder_iterator>()
+        {
+            stack_ = std::move(pending);
+            current_ = nullptr;
+            if (!stack_.empty())
+            {
+                take_top();
+            }
+        }
+
+        void take_top()
+        {
+            // take the next element
+            current_ = stack_.top();
+            // if need to process right part of the subtree
+            if (current_->right_)
+            {
+                // remove current element since it's saved in current_ field
+                stack_.pop();
+                // add right element and all it's left descendants to the stack
+                stack_.push(current_->right_);
+                while (stack_.top()->left_)
+                {
+                    stack_.push(stack_.top()->left_);
+                }
+            }
+        }
     };
 
     // preorder iterator (root - left - right order)
@@ -401,14 +761,19 @@ public:
         std::stack<bst_node<T>*> return_stack_;
     };
 
-    inorder_iterator begin_inorder() { return inorder_iterator(root_); }
-    inorder_iterator end_inorder() { return inorder_iterator(nullptr); }
+    inorder_iterator begin_inorder() const { return inorder_iterator(root_); }
+    inorder_iterator end_inorder() const { return inorder_iterator(nullptr); }
+
+    preorder_iterator begin_preorder() const { return preorder_iterator(root_); }
+    preorder_iterator end_preorder() const { return preorder_iterator(nullptr); }
 
-    preorder_iterator begin_preorder() { return preorder_iterator(root_); }
-    preorder_iterator end_preorder() { return preorder_iterator(nullptr); }
+    postorder_iterator begin_postorder() const { return postorder_iterator(root_); }
+    postorder_iterator end_postorder() const { return postorder_iterator(nullptr); }
 
-    postorder_iterator begin_postorder() { return postorder_iterator(root_); }
-    postorder_iterator end_postorder() { return postorder_iterator(nullptr); }
+    // inorder iterator starting from the first element that is not lower than value
+    inorder_iterator lower_bound(const T& value) const { return bound_iterator(value, true); }
+    // inorder iterator starting from the first element that is greater than value
+    inorder_iterator upper_bound(const T& value) const { return bound_iterator(value, false); }
 
 private:
     // possible directions of the child nodes in binary tree
@@ -472,6 +837,13 @@ private:
         search_result replace_result = find_extreme_in_subtree(delete_result.target->left_,
                                                                delete_result.target, child_direction::left, search_extreme::max_value);
 
+        // nodes between the deleting node and its inorder predecessor lose one descendant
+        for (bst_node<T>* node = delete_result.target->left_; node != replace_result.target; node = node->right_)
+        {
+            node->subtree_size_--;
+        }
+        replace_result.target->subtree_size_ = delete_result.target->subtree_size_ - 1;
+
         // delete inorder predecessor from the tree without deleting node itself
         switch (check_node_type(replace_result))
         {
@@ -497,9 +869,6 @@ private:
         // update deleting node's parent link
         update_parent_link(delete_result, replace_result.target);
 
-        // remove replacing node's parent link
-        update_parent_link(replace_result, nullptr);
-
         // update root if it was deleted
         if (root_ == delete_result.target)
         {
@@ -512,12 +881,85 @@ private:
         }
     }
 
+    static size_t subtree_size_of(const bst_node<T>* node)
+    {
+        return node ? node->subtree_size_ : 0;
+    }
+
+    // decrements subtree sizes of all the ancestors of the node with given value
+    // it repeats the walk that the operation has already made (and counted in stats),
+    // so it compares directly instead of through direction_to
+    void shrink_subtree_sizes_on_path(const T& value)
+    {
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            if (comparator_(value, current->value_))
+            {
+                current->subtree_size_--;
+                current = current->left_;
+            }
+            else if (comparator_(current->value_, value))
+            {
+                current->subtree_size_--;
+                current = current->right_;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    // builds the stack of pending nodes for the inorder iteration that starts from the bound of value
+    inorder_iterator bound_iterator(const T& value, const bool inclusive) const
+    {
+        std::stack<bst_node<T>*> pending;
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            const bool within_bound = inclusive
+                                          ? !comparator_(current->value_, value)
+                                          : comparator_(value, current->value_);
+            // node within the bound is pending until its left subtree is passed, looking for lower one there
+            if (within_bound)
+            {
+                pending.push(current);
+                current = current->left_;
+            }
+            else
+            {
+                current = current->right_;
+            }
+        }
+        return inorder_iterator(std::move(pending));
+    }
+
     // this method prevents spoiling the descendants of the deleting node, since it might have children still assigned
-    static void clear_children_and_delete_node(bst_node<T>* to_delete)
+    void clear_children_and_delete_node(bst_node<T>* to_delete)
     {
         to_delete->left_ = nullptr;
         to_delete->right_ = nullptr;
-        delete to_delete;
+        destroy_node(to_delete);
+    }
+
+    // all the nodes of the tree are allocated and freed here, so they are accounted in one place
+    template <typename... Args>
+    bst_node<T>* create_node(Args&&... args)
+    {
+        auto* node = new bst_node<T>(std::forward<Args>(args)...);
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.record_allocation(sizeof(bst_node<T>));
+#endif
+        return node;
+    }
+
+    void destroy_node(bst_node<T>* node)
+    {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.record_deallocation(sizeof(bst_node<T>));
+#endif
+        delete node;
     }
 
     node_type check_node_type(const search_result& result) const
@@ -565,7 +1007,8 @@ private:
         }
     }
 
-    search_result find_with_parent(const T& value) const
+    template <typename K>
+    search_result find_with_parent(const K& value) const
     {
         bst_node<T>* parent = nullptr;
         bst_node<T>* current = root_;
@@ -574,28 +1017,344 @@ private:
         // while haven't faced nullptr
         while (current)
         {
+            const child_direction next_direction = direction_to(value, current->value_);
             // return the node in case of value match
-            if (value == current->get())
+            if (next_direction == child_direction::none)
             {
                 return {parent, current, direction};
             }
 
             parent = current;
+            direction = next_direction;
+            current = direction == child_direction::right ? current->right_ : current->left_;
+        }
+        // if there was no return in the while loop - haven't found anything
+        return search_result{nullptr, nullptr, child_direction::none};
+    }
+
+    // direction from the node to the place of the key: right - greater values, left - lower values, none - match
+    template <typename K>
+    child_direction direction_to(const K& key, const T& node_value) const
+    {
+#ifdef BST_ENABLE_STATS
+        thread_totals().nodes_visited++;
+        thread_totals().comparisons++;
+#endif
+        if (comparator_(key, node_value))
+        {
+            return child_direction::left;
+        }
+#ifdef BST_ENABLE_STATS
+        thread_totals().comparisons++;
+#endif
+        if (comparator_(node_value, key))
+        {
+            return child_direction::right;
+        }
+        return child_direction::none;
+    }
+
+#ifdef BST_ENABLE_STATS
+    // running totals of the calling thread, operation_scope splits them between the operations
+    // they are per thread, so the concurrent finds don't count the comparisons of each other
+    static bst_operation_counters& thread_totals()
+    {
+        thread_local bst_operation_counters totals;
+        return totals;
+    }
+
+    // attributes the comparisons made by the calling thread during its lifetime to the operation
+    class operation_scope
+    {
+    public:
+        explicit operation_scope(bst_shared_operation_counters& counters)
+            : counters_(counters), comparisons_(thread_totals().comparisons),
+              nodes_visited_(thread_totals().nodes_visited)
+        {
+        }
+
+        ~operation_scope()
+        {
+            const bst_operation_counters& totals = thread_totals();
+            counters_.add(1, totals.comparisons - comparisons_, totals.nodes_visited - nodes_visited_);
+        }
+
+    private:
+        bst_shared_operation_counters& counters_;
+        uint64_t comparisons_;
+        uint64_t nodes_visited_;
+    };
+#endif
 
-            // right - greater values, left - lower values
-            if (value > current->get())
+    template <typename V>
+    bool add_value(V&& value)
+    {
+        bst_node<T>* parent = nullptr;
+        bst_node<T>** slot = find_insert_slot(value, &parent);
+        if (!slot)
+        {
+            return false;
+        }
+        // allocate only when the value is new
+        try
+        {
+            *slot = create_node(std::forward<V>(value));
+        }
+        catch (...)
+        {
+            // the path was already counted for the new node, the value itself might be moved from by now,
+            // so the path is found through the parent of the slot (it's the path to the parent plus the parent)
+            if (parent)
             {
-                direction = child_direction::right;
-                current = current->right_;
+                shrink_subtree_sizes_on_path(parent->value_);
+                parent->subtree_size_--;
             }
+            throw;
+        }
+        size_++;
+        return true;
+    }
+
+    // finds the empty link where value has to be placed, counting the new node in subtree sizes on the way
+    // nullptr for the duplicate value, parent (if given) receives the node that owns the link
+    bst_node<T>** find_insert_slot(const T& value, bst_node<T>** parent = nullptr)
+    {
+        // double pointer for delayed access to the pointer for creation by the caller
+        // covering special case for root creation
+        bst_node<T>** current = &root_;
+        // iterate through the tree until empty pointer in the correct place is found
+        while (*current)
+        {
+            const child_direction direction = direction_to(value, (*current)->value_);
+            // ignore duplicate values
+            if (direction == child_direction::none)
+            {
+                // the nodes above were already counted for the new value, roll that back
+                shrink_subtree_sizes_on_path(value);
+                return nullptr;
+            }
+
+            // the new node is going to be placed somewhere in this subtree
+            (*current)->subtree_size_++;
+            if (parent)
+            {
+                *parent = *current;
+            }
+            current = direction == child_direction::right ? &(*current)->right_ : &(*current)->left_;
+        }
+        return current;
+    }
+
+    // number of keys that save writes at once
+    static constexpr size_t serialization_block_size = 1 << 16;
+
+    // builds a balanced subtree from the sorted keys: the middle key is the root, halves are the subtrees
+    bst_node<T>* build_balanced(const T* keys, const size_t count)
+    {
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        const size_t middle = count / 2;
+        auto* node = create_node(keys[middle]);
+        node->left_ = build_balanced(keys, middle);
+        node->right_ = build_balanced(keys + middle + 1, count - middle - 1);
+        node->subtree_size_ = count;
+        return node;
+    }
+
+    // number of searches that find_batch keeps in flight (roughly the number of outstanding cache misses a core can have)
+    static constexpr size_t batch_group_size = 16;
+
+    template <typename ForwardIt, typename OutputIt, typename Converter>
+    OutputIt search_batch(ForwardIt keys_begin, ForwardIt keys_end, OutputIt out, Converter convert) const
+    {
+        // the empty batch is not a find
+        if (keys_begin == keys_end)
+        {
+            return out;
+        }
+        BST_STATS_OPERATION(find_counters_);
+#ifdef BST_ENABLE_STATS
+        // every key of the batch is a separate find (one call is counted by the operation scope)
+        find_counters_.add(static_cast<uint64_t>(std::distance(keys_begin, keys_end)) - 1, 0, 0);
+#endif
+
+        using key_type = typename std::iterator_traits<ForwardIt>::value_type;
+        const key_type* keys[batch_group_size];
+        bst_node<T>* current[batch_group_size];
+        bst_node<T>* found[batch_group_size];
+
+        while (keys_begin != keys_end)
+        {
+            // start the next group of searches from the root
+            size_t group_size = 0;
+            for (; group_size < batch_group_size && keys_begin != keys_end; ++group_size, ++keys_begin)
+            {
+                keys[group_size] = &*keys_begin;
+                current[group_size] = root_;
+                found[group_size] = nullptr;
+            }
+
+            // make one step of every unfinished search per pass
+            bool active = true;
+            while (active)
+            {
+                active = false;
+                for (size_t idx = 0; idx < group_size; ++idx)
+                {
+                    bst_node<T>* node = current[idx];
+                    if (!node)
+                    {
+                        continue;
+                    }
+
+                    const child_direction direction = direction_to(*keys[idx], node->value_);
+                    // return the node in case of value match
+                    if (direction == child_direction::none)
+                    {
+                        found[idx] = node;
+                        current[idx] = nullptr;
+                        continue;
+                    }
+
+                    bst_node<T>* next = direction == child_direction::right ? node->right_ : node->left_;
+                    // the node will be needed on the next pass only, the load runs meanwhile
+                    prefetch_for_read(next);
+                    current[idx] = next;
+                    active = active || next;
+                }
+            }
+
+            for (size_t idx = 0; idx < group_size; ++idx)
+            {
+                *out = convert(found[idx]);
+                ++out;
+            }
+        }
+        return out;
+    }
+
+    // ACCESS ADAPTATION
+    template <typename K>
+    bst_node<T>* find_adaptive(const K& value)
+    {
+        if (adaptation_ == access_adaptation::none)
+        {
+            return find_with_parent(value).target;
+        }
+
+        // remember the whole path, since nodes have no parent links
+        std::vector<bst_node<T>*>& path = access_path_buffer();
+        path.clear();
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            path.push_back(current);
+            const child_direction direction = direction_to(value, current->value_);
+            if (direction == child_direction::none)
+            {
+                splay_access_path(path, adaptation_ == access_adaptation::semi_splay);
+                return current;
+            }
+            current = direction == child_direction::right ? current->right_ : current->left_;
+        }
+        // misses don't change the tree
+        return nullptr;
+    }
+
+    // the path buffer is reused between the adaptive finds of the thread to avoid allocations on every lookup,
+    // it's not a member, so the trees that never adapt don't carry it
+    static std::vector<bst_node<T>*>& access_path_buffer()
+    {
+        thread_local std::vector<bst_node<T>*> path;
+        return path;
+    }
+
+    // lifts the last node of the access path with zig, zig-zig and zig-zag steps
+    void splay_access_path(std::vector<bst_node<T>*>& path, const bool semi)
+    {
+        size_t idx = path.size() - 1;
+        while (idx > 0)
+        {
+            bst_node<T>* node = path[idx];
+            bst_node<T>* parent = path[idx - 1];
+
+            // zig: parent is the root
+            if (idx == 1)
+            {
+                rotate_up(node, parent);
+                root_ = node;
+                return;
+            }
+
+            bst_node<T>* grandparent = path[idx - 2];
+            bst_node<T>* great_grandparent = idx > 2 ? path[idx - 3] : nullptr;
+            const bool zig_zig = (grandparent->left_ == parent) == (parent->left_ == node);
+
+            if (zig_zig)
+            {
+                // rotate the parent first, then the node over it
+                rotate_up(parent, grandparent);
+                replace_child(great_grandparent, grandparent, parent);
+                if (semi)
+                {
+                    // semi-splay stops here and continues lifting from the parent
+                    path[idx - 2] = parent;
+                    idx -= 2;
+                    continue;
+                }
+                rotate_up(node, parent);
+                replace_child(great_grandparent, parent, node);
+            }
+            // zig-zag: the node is rotated twice, first over the parent, then over the grandparent
             else
             {
-                direction = child_direction::left;
-                current = current->left_;
+                rotate_up(node, parent);
+                replace_child(grandparent, parent, node);
+                rotate_up(node, grandparent);
+                replace_child(great_grandparent, grandparent, node);
             }
+
+            path[idx - 2] = node;
+            idx -= 2;
+        }
+    }
+
+    // makes child the parent of its parent, the link to the parent from above has to be updated by the caller
+    static void rotate_up(bst_node<T>* child, bst_node<T>* parent)
+    {
+        if (parent->left_ == child)
+        {
+            parent->left_ = child->right_;
+            child->right_ = parent;
+        }
+        else
+        {
+            parent->right_ = child->left_;
+            child->left_ = parent;
+        }
+
+        // child takes the whole subtree, parent keeps what's left under it
+        child->subtree_size_ = parent->subtree_size_;
+        parent->subtree_size_ = subtree_size_of(parent->left_) + subtree_size_of(parent->right_) + 1;
+    }
+
+    // replaces the link from ancestor (nullptr means root) to old_child with new_child
+    void replace_child(bst_node<T>* ancestor, bst_node<T>* old_child, bst_node<T>* new_child)
+    {
+        if (!ancestor)
+        {
+            root_ = new_child;
+        }
+        else if (ancestor->left_ == old_child)
+        {
+            ancestor->left_ = new_child;
+        }
+        else
+        {
+            ancestor->right_ = new_child;
         }
-        // if there was no return in the while loop - haven't found anything
-        return search_result{nullptr, nullptr, child_direction::none};
     }
 
     // find extreme (min or max value) among node and its descendants
@@ -623,4 +1382,16 @@ private:
 
     bst_node<T>* root_;
     size_t size_;
+    access_adaptation adaptation_;
+    Compare comparator_;
+
+#ifdef BST_ENABLE_STATS
+    // find is const and may run on several threads, so the counters are atomic
+    mutable bst_shared_operation_counters find_counters_;
+    bst_shared_operation_counters add_counters_;
+    bst_shared_operation_counters remove_counters_;
+#endif
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+    allocation_account allocations_;
+#endif
 };
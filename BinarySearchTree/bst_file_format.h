@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// on-disk layout of a search tree: the header, then the sorted array of keys starting at keys_offset
+// keys are stored in the native byte order, so the files are meant to be read on the same platform
+struct bst_file_header
+{
+    char magic[8];
+    uint32_t format_version;
+    uint32_t key_size;
+    uint64_t key_count;
+    uint64_t keys_offset;
+
+    static constexpr uint32_t current_version = 1;
+    // keys start at the cache line boundary, so the mapped array can be searched in place
+    static constexpr uint64_t keys_alignment = 64;
+
+    static bst_file_header make(const uint32_t key_size, const uint64_t key_count)
+    {
+        bst_file_header header{};
+        std::memcpy(header.magic, expected_magic(), sizeof(header.magic));
+        header.format_version = current_version;
+        header.key_size = key_size;
+        header.key_count = key_count;
+        header.keys_offset = (sizeof(bst_file_header) + keys_alignment - 1) / keys_alignment * keys_alignment;
+        return header;
+    }
+
+    // throws if the file can't hold keys of given size or is truncated
+    void validate(const uint32_t expected_key_size, const uint64_t file_size) const
+    {
+        if (std::memcmp(magic, expected_magic(), sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("Couldn't load the tree: not a tree file");
+        }
+        if (format_version != current_version)
+        {
+            throw std::runtime_error("Couldn't load the tree: unsupported format version");
+        }
+        if (key_size != expected_key_size)
+        {
+            throw std::runtime_error("Couldn't load the tree: key size mismatch");
+        }
+        if (keys_offset % keys_alignment != 0 || keys_offset > file_size ||
+            (file_size - keys_offset) / key_size < key_count)
+        {
+            throw std::runtime_error("Couldn't load the tree: file is truncated or corrupted");
+        }
+    }
+
+    static const char* expected_magic()
+    {
+        return "BSTKEYS";
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// per-operation cost counters, they are collected only if BST_ENABLE_STATS is defined
+// (otherwise the counting code is not compiled at all and the counters stay zero)
+struct bst_operation_counters
+{
+    uint64_t calls = 0;
+    uint64_t comparisons = 0;
+    uint64_t nodes_visited = 0;
+};
+
+// bst_operation_counters that are updated with relaxed atomics,
+// so the const operations (find) can count from several threads at once
+struct bst_shared_operation_counters
+{
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> comparisons{0};
+    std::atomic<uint64_t> nodes_visited{0};
+
+    void add(const uint64_t call_count, const uint64_t comparison_count, const uint64_t nodes_visited_count)
+    {
+        calls.fetch_add(call_count, std::memory_order_relaxed);
+        comparisons.fetch_add(comparison_count, std::memory_order_relaxed);
+        nodes_visited.fetch_add(nodes_visited_count, std::memory_order_relaxed);
+    }
+
+    bst_operation_counters load() const
+    {
+        bst_operation_counters result;
+        result.calls = calls.load(std::memory_order_relaxed);
+        result.comparisons = comparisons.load(std::memory_order_relaxed);
+        result.nodes_visited = nodes_visited.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    void reset()
+    {
+        calls.store(0, std::memory_order_relaxed);
+        comparisons.store(0, std::memory_order_relaxed);
+        nodes_visited.store(0, std::memory_order_relaxed);
+    }
+};
+
+// shape of the tree and the cost of the operations performed on it
+struct bst_stats
+{
+    size_t size = 0;
+    // number of levels, 0 for the empty tree
+    size_t height = 0;
+    // nodes_per_level[depth] - number of nodes at given depth (root is at depth 0)
+    std::vector<size_t> nodes_per_level;
+    // number of nodes on the path from the root to a node, averaged over all nodes
+    // (cost of a successful search in nodes visited)
+    double average_search_path = 0;
+    // the longest search path, equal to height
+    size_t max_search_path = 0;
+
+    bst_operation_counters find;
+    bst_operation_counters add;
+    bst_operation_counters remove;
+
+    // writes the stats in the Prometheus text format, one metric per line
+    void dump(std::ostream& os, const std::string& prefix = "bst") const
+    {
+        os << prefix << "_size " << size << '\n';
+        os << prefix << "_height " << height << '\n';
+        os << prefix << "_average_search_path " << average_search_path << '\n';
+        os << prefix << "_max_search_path " << max_search_path << '\n';
+        for (size_t depth = 0; depth < nodes_per_level.size(); ++depth)
+        {
+            os << prefix << "_nodes_per_level{depth=\"" << depth << "\"} " << nodes_per_level[depth] << '\n';
+        }
+        dump_counters(os, prefix, "find", find);
+        dump_counters(os, prefix, "add", add);
+        dump_counters(os, prefix, "remove", remove);
+    }
+
+private:
+    static void dump_counters(std::ostream& os, const std::string& prefix, const char* operation,
+                              const bst_operation_counters& counters)
+    {
+        os << prefix << "_calls{operation=\"" << operation << "\"} " << counters.calls << '\n';
+        os << prefix << "_comparisons{operation=\"" << operation << "\"} " << counters.comparisons << '\n';
+        os << prefix << "_nodes_visited{operation=\"" << operation << "\"} " << counters.nodes_visited << '\n';
+    }
+};
@@ -0,0 +1,419 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// binary search tree with nodes stored in contiguous arrays instead of separate heap allocations
+// values and links are kept in separate arrays (structure of arrays), children are 32-bit indices,
+// so for small keys a node takes sizeof(T) + 8 bytes with no allocator overhead
+// removed slots are recycled by later insertions, compact() rebuilds the tree balanced in a cache-friendly order
+template <typename T, typename Compare = std::less<T>>
+class compact_binary_search_tree
+{
+public:
+    // placement of the nodes in the arrays after compact()
+    // inorder - slots follow the sorted order (range scans walk the arrays sequentially)
+    // van_emde_boas - recursive blocking of the levels: every search touches O(log_B n) cache lines
+    enum class node_layout { inorder, van_emde_boas };
+
+    compact_binary_search_tree() : root_(nil), free_head_(nil), size_(0)
+    {
+    }
+
+    explicit compact_binary_search_tree(const Compare& comparator)
+        : root_(nil), free_head_(nil), size_(0), comparator_(comparator)
+    {
+    }
+
+    bool add(const T& value)
+    {
+        uint32_t parent = nil;
+        bool is_left = false;
+        uint32_t current = root_;
+        // iterate through the tree until empty link in the correct place is found
+        while (current != nil)
+        {
+            parent = current;
+            if (comparator_(value, values_[current]))
+            {
+                is_left = true;
+                current = links_[current].left;
+            }
+            else if (comparator_(values_[current], value))
+            {
+                is_left = false;
+                current = links_[current].right;
+            }
+            // ignore duplicate values
+            else
+            {
+                return false;
+            }
+        }
+
+        const uint32_t slot = allocate_slot(value);
+        set_child(parent, is_left, slot);
+        size_++;
+        return true;
+    }
+
+    bool remove(const T& value)
+    {
+        uint32_t parent = nil;
+        bool is_left = false;
+        uint32_t target = root_;
+        while (target != nil)
+        {
+            if (comparator_(value, values_[target]))
+            {
+                parent = target;
+                is_left = true;
+                target = links_[target].left;
+            }
+            else if (comparator_(values_[target], value))
+            {
+                parent = target;
+                is_left = false;
+                target = links_[target].right;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        // nothing found
+        if (target == nil)
+        {
+            return false;
+        }
+
+        // two children: the inorder predecessor (max in left part of the tree) moves its value to the target
+        // and its own slot is removed instead
+        if (links_[target].left != nil && links_[target].right != nil)
+        {
+            uint32_t predecessor_parent = target;
+            uint32_t predecessor = links_[target].left;
+            is_left = true;
+            while (links_[predecessor].right != nil)
+            {
+                predecessor_parent = predecessor;
+                predecessor = links_[predecessor].right;
+                is_left = false;
+            }
+            values_[target] = std::move(values_[predecessor]);
+            parent = predecessor_parent;
+            target = predecessor;
+        }
+
+        // at most one child is left, it takes place of the target
+        const uint32_t child = links_[target].left != nil ? links_[target].left : links_[target].right;
+        set_child(parent, is_left, child);
+        release_slot(target);
+        size_--;
+        return true;
+    }
+
+    // pointer to the stored value, nullptr if there is no such value
+    // (invalidated by add, remove and compact)
+    const T* find(const T& value) const
+    {
+        uint32_t current = root_;
+        while (current != nil)
+        {
+            if (comparator_(value, values_[current]))
+            {
+                current = links_[current].left;
+            }
+            else if (comparator_(values_[current], value))
+            {
+                current = links_[current].right;
+            }
+            else
+            {
+                return &values_[current];
+            }
+        }
+        return nullptr;
+    }
+
+    bool contains(const T& value) const
+    {
+        return find(value) != nullptr;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    // number of slots in the arrays, including the free ones
+    size_t capacity() const
+    {
+        return values_.size();
+    }
+
+    void reserve(const size_t count)
+    {
+        values_.reserve(count);
+        links_.reserve(count);
+    }
+
+    void clear()
+    {
+        values_.clear();
+        links_.clear();
+        root_ = free_head_ = nil;
+        size_ = 0;
+    }
+
+    // rebuilds the tree perfectly balanced with nodes placed in the given order, drops the free slots
+    void compact(const node_layout layout = node_layout::van_emde_boas)
+    {
+        std::vector<T> sorted;
+        sorted.reserve(size_);
+        for (auto elem = begin_inorder(); elem != end_inorder(); ++elem)
+        {
+            sorted.push_back(std::move(values_[elem.slot()]));
+        }
+
+        // slot of every node, nodes are identified by their inorder rank
+        std::vector<uint32_t> slot_of_rank(sorted.size());
+        if (layout == node_layout::inorder)
+        {
+            for (size_t rank = 0; rank < sorted.size(); ++rank)
+            {
+                slot_of_rank[rank] = static_cast<uint32_t>(rank);
+            }
+        }
+        else
+        {
+            uint32_t next_slot = 0;
+            layout_van_emde_boas({0, sorted.size()}, height_of(sorted.size()), slot_of_rank, next_slot);
+        }
+
+        std::vector<T> values(sorted.size());
+        std::vector<node_links> links(sorted.size());
+        for (size_t rank = 0; rank < sorted.size(); ++rank)
+        {
+            values[slot_of_rank[rank]] = std::move(sorted[rank]);
+        }
+        root_ = link_balanced({0, sorted.size()}, slot_of_rank, links);
+
+        values_.swap(values);
+        links_.swap(links);
+        free_head_ = nil;
+    }
+
+    // ordered iteration from min to max
+    class inorder_iterator
+    {
+    public:
+        inorder_iterator() : tree_(nullptr), current_(nil)
+        {
+        }
+
+        explicit inorder_iterator(const compact_binary_search_tree* tree) : tree_(tree), current_(nil)
+        {
+            push_left_spine(tree_->root_);
+            advance();
+        }
+
+        const T& operator*() const
+        {
+            return tree_->values_[current_];
+        }
+
+        inorder_iterator& operator++()
+        {
+            push_left_spine(tree_->links_[current_].right);
+            advance();
+            return *this;
+        }
+
+        bool operator!=(const inorder_iterator& other) const
+        {
+            return current_ != other.current_;
+        }
+
+        bool operator==(const inorder_iterator& other) const
+        {
+            return current_ == other.current_;
+        }
+
+        uint32_t slot() const
+        {
+            return current_;
+        }
+
+    private:
+        void push_left_spine(uint32_t slot)
+        {
+            for (; slot != nil; slot = tree_->links_[slot].left)
+            {
+                stack_.push_back(slot);
+            }
+        }
+
+        void advance()
+        {
+            if (stack_.empty())
+            {
+                current_ = nil;
+                return;
+            }
+            current_ = stack_.back();
+            stack_.pop_back();
+        }
+
+        const compact_binary_search_tree* tree_;
+        uint32_t current_;
+        std::vector<uint32_t> stack_;
+    };
+
+    inorder_iterator begin_inorder() const { return inorder_iterator(this); }
+    inorder_iterator end_inorder() const { return inorder_iterator(); }
+
+private:
+    // empty link, also the end of the free list
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+
+    struct node_links
+    {
+        uint32_t left;
+        uint32_t right;
+    };
+
+    // half-open range of ranks, the node of the range is its middle
+    struct rank_range
+    {
+        size_t begin;
+        size_t end;
+
+        size_t middle() const { return begin + (end - begin) / 2; }
+        rank_range lower() const { return {begin, middle()}; }
+        rank_range upper() const { return {middle() + 1, end}; }
+        bool empty() const { return begin == end; }
+    };
+
+    // free slots are chained through their left links
+    uint32_t allocate_slot(const T& value)
+    {
+        if (free_head_ != nil)
+        {
+            const uint32_t slot = free_head_;
+            free_head_ = links_[slot].left;
+            values_[slot] = value;
+            links_[slot] = {nil, nil};
+            return slot;
+        }
+
+        if (values_.size() >= nil)
+        {
+            throw std::runtime_error("Couldn't add the value: the tree is out of 32-bit indices");
+        }
+        values_.push_back(value);
+        links_.push_back({nil, nil});
+        return static_cast<uint32_t>(values_.size() - 1);
+    }
+
+    void release_slot(const uint32_t slot)
+    {
+        links_[slot] = {free_head_, nil};
+        free_head_ = slot;
+    }
+
+    // nil parent means root
+    void set_child(const uint32_t parent, const bool is_left, const uint32_t child)
+    {
+        if (parent == nil)
+        {
+            root_ = child;
+        }
+        else if (is_left)
+        {
+            links_[parent].left = child;
+        }
+        else
+        {
+            links_[parent].right = child;
+        }
+    }
+
+    // number of levels of the balanced tree with count nodes
+    static size_t height_of(size_t count)
+    {
+        size_t height = 0;
+        for (; count > 0; count /= 2)
+        {
+            height++;
+        }
+        return height;
+    }
+
+    // assigns slots to the top `levels` levels of the subtree in the van Emde Boas order:
+    // the top half of the levels first, then every subtree hanging below it, each laid out recursively
+    static void layout_van_emde_boas(const rank_range range, const size_t levels,
+                                     std::vector<uint32_t>& slot_of_rank, uint32_t& next_slot)
+    {
+        if (range.empty() || levels == 0)
+        {
+            return;
+        }
+        if (levels == 1)
+        {
+            slot_of_rank[range.middle()] = next_slot++;
+            return;
+        }
+
+        const size_t top_levels = levels / 2;
+        layout_van_emde_boas(range, top_levels, slot_of_rank, next_slot);
+
+        std::vector<rank_range> bottom_roots;
+        collect_at_depth(range, top_levels, bottom_roots);
+        for (const rank_range& bottom : bottom_roots)
+        {
+            layout_van_emde_boas(bottom, levels - top_levels, slot_of_rank, next_slot);
+        }
+    }
+
+    // subtrees that are depth levels below the range node, from left to right
+    static void collect_at_depth(const rank_range range, const size_t depth, std::vector<rank_range>& result)
+    {
+        if (range.empty())
+        {
+            return;
+        }
+        if (depth == 0)
+        {
+            result.push_back(range);
+            return;
+        }
+        collect_at_depth(range.lower(), depth - 1, result);
+        collect_at_depth(range.upper(), depth - 1, result);
+    }
+
+    // links the balanced tree over the ranks, returns the slot of the subtree root
+    static uint32_t link_balanced(const rank_range range, const std::vector<uint32_t>& slot_of_rank,
+                                  std::vector<node_links>& links)
+    {
+        if (range.empty())
+        {
+            return nil;
+        }
+        const uint32_t slot = slot_of_rank[range.middle()];
+        links[slot] = {link_balanced(range.lower(), slot_of_rank, links),
+                       link_balanced(range.upper(), slot_of_rank, links)};
+        return slot;
+    }
+
+    std::vector<T> values_;
+    std::vector<node_links> links_;
+    uint32_t root_;
+    uint32_t free_head_;
+    size_t size_;
+    Compare comparator_;
+};
@@ -0,0 +1,351 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "../Common/epoch_reclamation.h"
+
+// binary search tree that can be shared between threads
+// readers (find, contains, for_each_inorder) never take locks, they are only registered in the epoch domain
+// writers (add, remove) search without locks as well and then lock only the nodes they change, validating that
+// the nodes are still in the tree (optimistic locking), so writers in different parts of the tree don't wait
+// for each other and nobody waits for the readers: removed nodes are retired to the epoch domain
+// a node with two children can't be unlinked without moving its successor (which the readers might be
+// walking to), so it's only marked as removed and keeps routing the searches; it's unlinked later,
+// when it has lost a child, or revived if its value is added again
+template <typename T>
+class concurrent_binary_search_tree
+{
+public:
+    concurrent_binary_search_tree() : root_(nullptr), size_(0)
+    {
+    }
+
+    concurrent_binary_search_tree(const concurrent_binary_search_tree& other) = delete;
+    concurrent_binary_search_tree& operator=(const concurrent_binary_search_tree& other) = delete;
+
+    bool add(const T& value)
+    {
+        // the guard keeps the nodes found by the search alive while they are locked
+        epoch_domain::guard guard;
+        while (true)
+        {
+            const search_result found = search(value);
+            if (found.target)
+            {
+                std::lock_guard<std::mutex> lock(found.target->mutex);
+                if (found.target->unlinked)
+                {
+                    continue;
+                }
+                // ignore duplicate values
+                if (!found.target->removed.load(std::memory_order_relaxed))
+                {
+                    return false;
+                }
+                found.target->removed.store(false, std::memory_order_release);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_of(found.parent));
+            // somebody has taken the place or unlinked the parent since the search - start over
+            if ((found.parent && found.parent->unlinked) || found.link->load(std::memory_order_relaxed))
+            {
+                continue;
+            }
+            // the node is completely built before it becomes visible to the readers
+            found.link->store(new node(value), std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    bool remove(const T& value)
+    {
+        epoch_domain::guard guard;
+        while (true)
+        {
+            const search_result found = search(value);
+            // nothing found
+            if (!found.target)
+            {
+                return false;
+            }
+
+            // locks go from the parent to the child, like in every other writer
+            std::lock_guard<std::mutex> parent_lock(mutex_of(found.parent));
+            std::lock_guard<std::mutex> lock(found.target->mutex);
+            if (!still_linked(found))
+            {
+                continue;
+            }
+            if (found.target->removed.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            if (found.target->left.load(std::memory_order_relaxed) &&
+                found.target->right.load(std::memory_order_relaxed))
+            {
+                found.target->removed.store(true, std::memory_order_release);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            unlink(found);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+
+        // the parent could be a removed node that has just lost the child it was kept for
+        unlink_removed_on_path(value);
+        return true;
+    }
+
+    // returns a copy of the stored value, since the node might be reclaimed after the call
+    std::optional<T> find(const T& value) const
+    {
+        epoch_domain::guard guard;
+        const node* found = find_node(value);
+        return found ? std::optional<T>(found->value) : std::nullopt;
+    }
+
+    bool contains(const T& value) const
+    {
+        epoch_domain::guard guard;
+        return find_node(value) != nullptr;
+    }
+
+    // ordered iteration from min to max without locks
+    // concurrent changes may be visible partially, but every value that stays in the tree during
+    // the whole iteration is visited exactly once
+    template <typename Func>
+    void for_each_inorder(Func func) const
+    {
+        epoch_domain::guard guard;
+
+        std::vector<const node*> stack;
+        const node* current = root_.load(std::memory_order_acquire);
+        while (current || !stack.empty())
+        {
+            // go to the most left element of the subtree
+            while (current)
+            {
+                stack.push_back(current);
+                current = current->left.load(std::memory_order_acquire);
+            }
+            current = stack.back();
+            stack.pop_back();
+            if (!current->removed.load(std::memory_order_acquire))
+            {
+                func(current->value);
+            }
+            current = current->right.load(std::memory_order_acquire);
+        }
+    }
+
+    size_t size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    // detaches the whole tree at once, the writers that are still inside of it either finish before their node
+    // is swept here (and their change is dropped with the rest) or see it unlinked and start over
+    void clear()
+    {
+        node* old_root;
+        {
+            std::lock_guard<std::mutex> lock(root_mutex_);
+            old_root = root_.exchange(nullptr, std::memory_order_acq_rel);
+        }
+
+        std::vector<node*> stack;
+        size_t live = 0;
+        if (old_root)
+        {
+            stack.push_back(old_root);
+        }
+        while (!stack.empty())
+        {
+            node* current = stack.back();
+            stack.pop_back();
+            {
+                // the children can't change after the node is marked
+                std::lock_guard<std::mutex> lock(current->mutex);
+                current->unlinked = true;
+                live += current->removed.load(std::memory_order_relaxed) ? 0 : 1;
+                if (node* left = current->left.load(std::memory_order_relaxed))
+                {
+                    stack.push_back(left);
+                }
+                if (node* right = current->right.load(std::memory_order_relaxed))
+                {
+                    stack.push_back(right);
+                }
+            }
+            epoch_domain::global().retire(current);
+        }
+        size_.fetch_sub(live, std::memory_order_relaxed);
+    }
+
+    ~concurrent_binary_search_tree()
+    {
+        // no readers can be left at destruction time
+        delete_subtree(root_.load(std::memory_order_relaxed));
+    }
+
+private:
+    struct node
+    {
+        explicit node(const T& node_value) : value(node_value), left(nullptr), right(nullptr), removed(false)
+        {
+        }
+
+        const T value;
+        std::atomic<node*> left;
+        std::atomic<node*> right;
+        // the value is not in the tree, the node only routes the searches
+        std::atomic<bool> removed;
+        // serializes the writers that change the links of the node or the node itself
+        std::mutex mutex;
+        // set under the mutex once the node is out of the tree, the writers that locked it too late start over
+        bool unlinked = false;
+    };
+
+    // target is the node with the value (nullptr if there is none), link is the pointer to it in the parent
+    // (or root_ for the root)
+    struct search_result
+    {
+        node* parent;
+        std::atomic<node*>* link;
+        node* target;
+    };
+
+    // the root link has no node, it's protected by a separate mutex
+    std::mutex& mutex_of(node* parent)
+    {
+        return parent ? parent->mutex : root_mutex_;
+    }
+
+    // has to be called with the locks of the parent and the target, checks that the search result is still valid
+    static bool still_linked(const search_result& found)
+    {
+        return !(found.parent && found.parent->unlinked) && !found.target->unlinked &&
+               found.link->load(std::memory_order_relaxed) == found.target;
+    }
+
+    // has to be called inside of the reader critical section
+    search_result search(const T& value)
+    {
+        node* parent = nullptr;
+        std::atomic<node*>* link = &root_;
+        node* current = link->load(std::memory_order_acquire);
+        while (current && !(value == current->value))
+        {
+            parent = current;
+            // right - greater values, left - lower values
+            link = value > current->value ? &current->right : &current->left;
+            current = link->load(std::memory_order_acquire);
+        }
+        return {parent, link, current};
+    }
+
+    // replaces the target that has at most one child with the child, readers that are already inside of the
+    // target still see the child; has to be called with the locks of the parent and the target
+    void unlink(const search_result& found)
+    {
+        node* left = found.target->left.load(std::memory_order_relaxed);
+        found.link->store(left ? left : found.target->right.load(std::memory_order_relaxed),
+                          std::memory_order_release);
+        found.target->unlinked = true;
+        epoch_domain::global().retire(found.target);
+    }
+
+    // unlinks the removed routing nodes on the path to value that don't have two children anymore
+    // (each one makes its own parent a candidate, so the path is searched again after every unlink)
+    void unlink_removed_on_path(const T& value)
+    {
+        bool unlinked = true;
+        while (unlinked)
+        {
+            unlinked = false;
+            node* parent = nullptr;
+            std::atomic<node*>* link = &root_;
+            node* current = link->load(std::memory_order_acquire);
+            while (current && !unlinked)
+            {
+                if (current->removed.load(std::memory_order_acquire) &&
+                    !(current->left.load(std::memory_order_acquire) && current->right.load(std::memory_order_acquire)))
+                {
+                    std::lock_guard<std::mutex> parent_lock(mutex_of(parent));
+                    std::lock_guard<std::mutex> lock(current->mutex);
+                    const search_result found{parent, link, current};
+                    // revived or got a second child meanwhile - leave it
+                    if (still_linked(found) && current->removed.load(std::memory_order_relaxed) &&
+                        !(current->left.load(std::memory_order_relaxed) &&
+                          current->right.load(std::memory_order_relaxed)))
+                    {
+                        unlink(found);
+                        unlinked = true;
+                    }
+                }
+                if (value == current->value)
+                {
+                    break;
+                }
+                parent = current;
+                link = value > current->value ? &current->right : &current->left;
+                current = link->load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    // has to be called inside of the reader critical section
+    const node* find_node(const T& value) const
+    {
+        const node* current = root_.load(std::memory_order_acquire);
+        while (current)
+        {
+            // return the node in case of value match
+            if (value == current->value)
+            {
+                return current->removed.load(std::memory_order_acquire) ? nullptr : current;
+            }
+
+            // right - greater values, left - lower values
+            current = value > current->value
+                          ? current->right.load(std::memory_order_acquire)
+                          : current->left.load(std::memory_order_acquire);
+        }
+        return nullptr;
+    }
+
+    static void delete_subtree(node* subtree_root)
+    {
+        std::vector<node*> stack;
+        if (subtree_root)
+        {
+            stack.push_back(subtree_root);
+        }
+        while (!stack.empty())
+        {
+            node* to_delete = stack.back();
+            stack.pop_back();
+            if (node* left = to_delete->left.load(std::memory_order_relaxed))
+            {
+                stack.push_back(left);
+            }
+            if (node* right = to_delete->right.load(std::memory_order_relaxed))
+            {
+                stack.push_back(right);
+            }
+            delete to_delete;
+        }
+    }
+
+    std::atomic<node*> root_;
+    std::atomic<size_t> size_;
+    std::mutex root_mutex_;
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../Common/prefetch.h"
+#include "bst_file_format.h"
+
+// read-only view of the file written by binary_search_tree::save, mapped into memory
+// nothing is deserialized: the sorted keys are searched in place, so opening takes constant time
+// and the pages are loaded by the OS on demand
+// Compare has to be the comparator of the saved tree, since the keys are in its order
+template <typename T, typename Compare = std::less<T>>
+class mapped_search_tree
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Mapped trees require trivially copyable keys");
+
+public:
+    explicit mapped_search_tree(const std::string& path, const Compare& comparator = Compare())
+        : data_(nullptr), data_size_(0), keys_(nullptr), size_(0), comparator_(comparator)
+    {
+        map_file(path);
+
+        try
+        {
+            bst_file_header header{};
+            if (data_size_ < sizeof(header))
+            {
+                throw std::runtime_error("Couldn't load the tree: file is truncated or corrupted");
+            }
+            std::memcpy(&header, data_, sizeof(header));
+            header.validate(sizeof(T), data_size_);
+
+            keys_ = reinterpret_cast<const T*>(static_cast<const char*>(data_) + header.keys_offset);
+            size_ = static_cast<size_t>(header.key_count);
+        }
+        catch (...)
+        {
+            unmap_file();
+            throw;
+        }
+    }
+
+    mapped_search_tree(const mapped_search_tree& other) = delete;
+    mapped_search_tree& operator=(const mapped_search_tree& other) = delete;
+
+    // pointer to the key in the mapped file, nullptr if there is no such key
+    const T* find(const T& value) const
+    {
+        if (size_ == 0)
+        {
+            return nullptr;
+        }
+
+        // branchless binary search for the last key that doesn't go after value
+        const T* base = keys_;
+        size_t count = size_;
+        while (count > 1)
+        {
+            const size_t half = count / 2;
+            // both candidates of the next step are loaded while the current one is compared
+            prefetch_for_read(base + (count - half) / 2);
+            prefetch_for_read(base + half + (count - half) / 2);
+            base = comparator_(value, *(base + half)) ? base : base + half;
+            count -= half;
+        }
+        // keys are equal if neither is less
+        return !comparator_(*base, value) && !comparator_(value, *base) ? base : nullptr;
+    }
+
+    bool contains(const T& value) const
+    {
+        return find(value) != nullptr;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    // inorder iteration is a walk over the sorted array
+    const T* begin() const { return keys_; }
+    const T* end() const { return keys_ + size_; }
+
+    ~mapped_search_tree()
+    {
+        unmap_file();
+    }
+
+private:
+#ifdef _WIN32
+    void map_file(const std::string& path)
+    {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to open " + path);
+        }
+
+        LARGE_INTEGER file_size;
+        HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0
+                             ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+                             : nullptr;
+        CloseHandle(file);
+        if (!mapping)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to map " + path);
+        }
+
+        data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        // the view keeps the mapping alive
+        CloseHandle(mapping);
+        if (!data_)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to map " + path);
+        }
+        data_size_ = static_cast<size_t>(file_size.QuadPart);
+    }
+
+    void unmap_file()
+    {
+        if (data_)
+        {
+            UnmapViewOfFile(data_);
+            data_ = nullptr;
+        }
+    }
+#else
+    void map_file(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to open " + path);
+        }
+
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+        {
+            close(fd);
+            throw std::runtime_error("Couldn't load the tree: file is truncated or corrupted");
+        }
+
+        data_size_ = static_cast<size_t>(file_stat.st_size);
+        void* data = mmap(nullptr, data_size_, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("Couldn't load the tree: unable to map " + path);
+        }
+        data_ = data;
+    }
+
+    void unmap_file()
+    {
+        if (data_)
+        {
+            munmap(const_cast<void*>(data_), data_size_);
+            data_ = nullptr;
+        }
+    }
+#endif
+
+    const void* data_;
+    size_t data_size_;
+    const T* keys_;
+    size_t size_;
+    Compare comparator_;
+};
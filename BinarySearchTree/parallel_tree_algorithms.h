@@ -0,0 +1,200 @@
+#pragma once
+#include <algorithm>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Common/thread_pool.h"
+
+// parallel traversals of the trees built from bst_node (binary_search_tree, weight_balanced_tree)
+// the tree is cut into subtrees using the subtree sizes: every subtree becomes a task for the pool,
+// the few nodes above them are processed by the calling thread
+// the tree must not be modified during the call
+
+namespace parallel_tree_detail
+{
+    // a whole subtree, or a single node above the subtrees; offset is the inorder index of the first element
+    template <typename Node>
+    struct tree_piece
+    {
+        Node* node;
+        size_t offset;
+        bool whole_subtree;
+    };
+
+    // enough pieces per thread to even out the subtrees of different shapes
+    constexpr size_t pieces_per_thread = 8;
+    // smaller subtrees are not worth a task
+    constexpr size_t min_grain = 1 << 12;
+
+    template <typename Node>
+    size_t size_of(const Node* node)
+    {
+        return node ? node->subtree_size() : 0;
+    }
+
+    // cuts the tree into pieces of at most grain nodes, returned in the inorder
+    template <typename Node>
+    std::vector<tree_piece<Node>> split_into_pieces(Node* root, const size_t thread_count)
+    {
+        const size_t grain = std::max(min_grain, size_of(root) / (thread_count * pieces_per_thread));
+
+        std::vector<tree_piece<Node>> pieces;
+        // explicit stack: the tree might be too deep for the recursion
+        std::vector<std::pair<Node*, size_t>> stack;
+        stack.emplace_back(root, 0);
+        while (!stack.empty())
+        {
+            Node* node = stack.back().first;
+            const size_t offset = stack.back().second;
+            stack.pop_back();
+            if (!node)
+            {
+                continue;
+            }
+            if (node->subtree_size() <= grain)
+            {
+                pieces.push_back({node, offset, true});
+                continue;
+            }
+
+            const size_t left_size = size_of(node->left());
+            pieces.push_back({node, offset + left_size, false});
+            stack.emplace_back(node->left(), offset);
+            stack.emplace_back(node->right(), offset + left_size + 1);
+        }
+
+        // pieces don't overlap, so their offsets define the order
+        std::sort(pieces.begin(), pieces.end(),
+                  [](const tree_piece<Node>& l, const tree_piece<Node>& r) { return l.offset < r.offset; });
+        return pieces;
+    }
+
+    // sequential inorder walk of the subtree
+    template <typename Node, typename Func>
+    void for_each_inorder(Node* subtree_root, Func& func)
+    {
+        std::vector<Node*> stack;
+        Node* current = subtree_root;
+        while (current || !stack.empty())
+        {
+            while (current)
+            {
+                stack.push_back(current);
+                current = current->left();
+            }
+            current = stack.back();
+            stack.pop_back();
+            func(current->get());
+            current = current->right();
+        }
+    }
+
+    // runs piece_func on the whole subtrees in the pool and node_func on the single nodes in the calling thread
+    // results are returned in the inorder of the pieces
+    template <typename Node, typename PieceFunc, typename NodeFunc>
+    auto run_pieces(Node* root, thread_pool& pool, PieceFunc piece_func, NodeFunc node_func)
+        -> std::vector<decltype(piece_func(std::declval<tree_piece<Node>>()))>
+    {
+        using result_type = decltype(piece_func(std::declval<tree_piece<Node>>()));
+
+        const std::vector<tree_piece<Node>> pieces = split_into_pieces(root, pool.size());
+        std::vector<std::future<result_type>> futures(pieces.size());
+        for (size_t idx = 0; idx < pieces.size(); ++idx)
+        {
+            if (pieces[idx].whole_subtree)
+            {
+                const tree_piece<Node> piece = pieces[idx];
+                futures[idx] = pool.submit([piece, &piece_func] { return piece_func(piece); });
+            }
+        }
+
+        std::vector<result_type> results;
+        results.reserve(pieces.size());
+        for (size_t idx = 0; idx < pieces.size(); ++idx)
+        {
+            results.push_back(pieces[idx].whole_subtree ? futures[idx].get() : node_func(pieces[idx]));
+        }
+        return results;
+    }
+}
+
+// calls func for every value of the tree, concurrently and in no particular order
+template <typename Tree, typename Func>
+void parallel_for_each(const Tree& tree, Func func, thread_pool& pool = thread_pool::shared())
+{
+    using namespace parallel_tree_detail;
+    using node_type = std::remove_pointer_t<decltype(tree.root())>;
+
+    run_pieces(
+        tree.root(), pool,
+        [&func](const tree_piece<node_type>& piece)
+        {
+            Func local_func = func;
+            for_each_inorder(piece.node, local_func);
+            return true;
+        },
+        [&func](const tree_piece<node_type>& piece)
+        {
+            func(piece.node->get());
+            return true;
+        });
+}
+
+// combines map(value) of all the values with reduce in the inorder: reduce(...reduce(identity, map(min))..., map(max))
+// reduce has to be associative and identity has to be its neutral element
+template <typename Tree, typename Result, typename MapFunc, typename ReduceFunc>
+Result parallel_reduce(const Tree& tree, Result identity, MapFunc map, ReduceFunc reduce,
+                       thread_pool& pool = thread_pool::shared())
+{
+    using namespace parallel_tree_detail;
+    using node_type = std::remove_pointer_t<decltype(tree.root())>;
+
+    std::vector<Result> partial = run_pieces(
+        tree.root(), pool,
+        [&](const tree_piece<node_type>& piece)
+        {
+            Result accumulated = identity;
+            auto accumulate = [&](const auto& value) { accumulated = reduce(std::move(accumulated), map(value)); };
+            for_each_inorder(piece.node, accumulate);
+            return accumulated;
+        },
+        [&](const tree_piece<node_type>& piece) { return Result(map(piece.node->get())); });
+
+    Result result = std::move(identity);
+    for (auto& value : partial)
+    {
+        result = reduce(std::move(result), std::move(value));
+    }
+    return result;
+}
+
+// copies the values in the inorder to the range starting at out (it has to hold tree.size() elements)
+// every task writes its subtree at the offset given by the sizes of the subtrees before it
+template <typename Tree, typename RandomIt>
+RandomIt parallel_export(const Tree& tree, RandomIt out, thread_pool& pool = thread_pool::shared())
+{
+    using namespace parallel_tree_detail;
+    using node_type = std::remove_pointer_t<decltype(tree.root())>;
+
+    run_pieces(
+        tree.root(), pool,
+        [out](const tree_piece<node_type>& piece)
+        {
+            RandomIt position = out + piece.offset;
+            auto write = [&position](const auto& value)
+            {
+                *position = value;
+                ++position;
+            };
+            for_each_inorder(piece.node, write);
+            return true;
+        },
+        [out](const tree_piece<node_type>& piece)
+        {
+            *(out + piece.offset) = piece.node->get();
+            return true;
+        });
+    return out + size_of(tree.root());
+}
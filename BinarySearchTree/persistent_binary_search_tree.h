@@ -0,0 +1,319 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class persistent_binary_search_tree;
+
+// immutable node, shared between versions of the tree
+template <typename T>
+class persistent_bst_node
+{
+    friend class persistent_binary_search_tree<T>;
+
+public:
+    const T& get() const
+    {
+        return value_;
+    }
+
+    const persistent_bst_node* left() const
+    {
+        return left_.get();
+    }
+
+    const persistent_bst_node* right() const
+    {
+        return right_.get();
+    }
+
+    // children that are owned only by this node are freed in a loop instead of the recursion of the shared_ptr
+    // destructors: the tree isn't balanced, a version built from sorted values is a chain as deep as the tree size
+    ~persistent_bst_node()
+    {
+        std::vector<node_ptr> pending;
+        take_if_last_owner(left_, pending);
+        take_if_last_owner(right_, pending);
+        while (!pending.empty())
+        {
+            node_ptr current = std::move(pending.back());
+            pending.pop_back();
+            // nodes are created non-const, the last owner may take the children before the node goes away
+            auto& owned = const_cast<persistent_bst_node&>(*current);
+            take_if_last_owner(owned.left_, pending);
+            take_if_last_owner(owned.right_, pending);
+        }
+    }
+
+private:
+    using node_ptr = std::shared_ptr<const persistent_bst_node>;
+
+    persistent_bst_node(const T& value, node_ptr left, node_ptr right)
+        : value_(value), left_(std::move(left)), right_(std::move(right))
+    {
+    }
+
+    // a node shared with other versions only loses one reference, so it isn't freed here
+    // (use_count can't grow from 1 behind our back: copies are made only from the owners)
+    static void take_if_last_owner(node_ptr& child, std::vector<node_ptr>& pending)
+    {
+        if (child && child.use_count() == 1)
+        {
+            pending.push_back(std::move(child));
+        }
+    }
+
+    T value_;
+    node_ptr left_;
+    node_ptr right_;
+};
+
+// persistent binary search tree: add and remove never change existing nodes, they copy the path from the root
+// to the changed place and share the rest of the nodes with the previous version
+// snapshot() is O(1) and independent of the tree size, nodes are freed when the last version using them is gone
+// the tree can be shared between threads: writers are serialized, snapshots and reads don't wait for writers
+template <typename T>
+class persistent_binary_search_tree
+{
+    using node = persistent_bst_node<T>;
+    using node_ptr = std::shared_ptr<const node>;
+
+public:
+    persistent_binary_search_tree() : size_(0)
+    {
+    }
+
+    // copying is taking a snapshot
+    persistent_binary_search_tree(const persistent_binary_search_tree& other) : size_(0)
+    {
+        std::tie(root_, size_) = other.current_version();
+    }
+
+    persistent_binary_search_tree& operator=(const persistent_binary_search_tree& other)
+    {
+        if (this != &other)
+        {
+            std::pair<node_ptr, size_t> version = other.current_version();
+            // declared before the lock, so the replaced version is freed after the lock is released
+            node_ptr replaced;
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            replaced = publish(std::move(version.first), version.second);
+        }
+        return *this;
+    }
+
+    // point-in-time view of the tree that isn't affected by the later changes
+    persistent_binary_search_tree snapshot() const
+    {
+        return persistent_binary_search_tree(*this);
+    }
+
+    bool add(const T& value)
+    {
+        // declared before the lock, so the replaced version is freed after the lock is released
+        std::pair<node_ptr, size_t> version;
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        version = current_version();
+
+        // collect the path to the place of the new node
+        std::vector<const node*> path;
+        const node* current = version.first.get();
+        while (current)
+        {
+            // ignore duplicate values
+            if (value == current->value_)
+            {
+                return false;
+            }
+            path.push_back(current);
+            // right - greater values, left - lower values
+            current = value > current->value_ ? current->right_.get() : current->left_.get();
+        }
+
+        node_ptr new_root = copy_path(path, value, node_ptr(new node(value, nullptr, nullptr)));
+        publish(std::move(new_root), version.second + 1);
+        return true;
+    }
+
+    bool remove(const T& value)
+    {
+        // declared before the lock, so the replaced version is freed after the lock is released
+        std::pair<node_ptr, size_t> version;
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        version = current_version();
+
+        std::vector<const node*> path;
+        const node* target = version.first.get();
+        while (target && !(value == target->value_))
+        {
+            path.push_back(target);
+            target = value > target->value_ ? target->right_.get() : target->left_.get();
+        }
+
+        // nothing found
+        if (!target)
+        {
+            return false;
+        }
+
+        // subtree that takes place of the deleting node
+        node_ptr replacement;
+        if (!target->left_ || !target->right_)
+        {
+            replacement = target->left_ ? target->left_ : target->right_;
+        }
+        else
+        {
+            // inorder predecessor (max in left part of the tree) takes place of the deleting node
+            std::vector<const node*> spine;
+            const node* predecessor = target->left_.get();
+            while (predecessor->right_)
+            {
+                spine.push_back(predecessor);
+                predecessor = predecessor->right_.get();
+            }
+            node_ptr left = copy_path(spine, predecessor->value_, predecessor->left_);
+            replacement = node_ptr(new node(predecessor->value_, std::move(left), target->right_));
+        }
+
+        node_ptr new_root = copy_path(path, value, std::move(replacement));
+        publish(std::move(new_root), version.second - 1);
+        return true;
+    }
+
+    bool contains(const T& value) const
+    {
+        // the version is kept alive by the local pointer even if a writer replaces it meanwhile
+        node_ptr root = current_version().first;
+        const node* current = root.get();
+        while (current)
+        {
+            if (value == current->value_)
+            {
+                return true;
+            }
+            current = value > current->value_ ? current->right_.get() : current->left_.get();
+        }
+        return false;
+    }
+
+    size_t size() const
+    {
+        return current_version().second;
+    }
+
+    void clear()
+    {
+        // declared before the lock, so the replaced version is freed after the lock is released
+        node_ptr replaced;
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        replaced = publish(nullptr, 0);
+    }
+
+    // ordered iteration from min to max over the version that was current at the creation of the iterator
+    class inorder_iterator
+    {
+    public:
+        inorder_iterator() : current_(nullptr)
+        {
+        }
+
+        explicit inorder_iterator(node_ptr root) : version_(std::move(root)), current_(nullptr)
+        {
+            push_left_spine(version_.get());
+            advance();
+        }
+
+        const T& operator*() const
+        {
+            return current_->get();
+        }
+
+        inorder_iterator& operator++()
+        {
+            push_left_spine(current_->right());
+            advance();
+            return *this;
+        }
+
+        bool operator!=(const inorder_iterator& other) const
+        {
+            return current_ != other.current_;
+        }
+
+        bool operator==(const inorder_iterator& other) const
+        {
+            return current_ == other.current_;
+        }
+
+    private:
+        void push_left_spine(const node* subtree_root)
+        {
+            for (; subtree_root; subtree_root = subtree_root->left())
+            {
+                stack_.push(subtree_root);
+            }
+        }
+
+        void advance()
+        {
+            if (stack_.empty())
+            {
+                current_ = nullptr;
+                return;
+            }
+            current_ = stack_.top();
+            stack_.pop();
+        }
+
+        // holds the version, so it can't be freed during the iteration
+        node_ptr version_;
+        const node* current_;
+        std::stack<const node*> stack_;
+    };
+
+    inorder_iterator begin_inorder() const { return inorder_iterator(current_version().first); }
+    inorder_iterator end_inorder() const { return inorder_iterator(); }
+
+private:
+    // copies the nodes of the path from the bottom to the top, the last node of the path gets new_child
+    // on the side of value
+    static node_ptr copy_path(const std::vector<const node*>& path, const T& value, node_ptr new_child)
+    {
+        for (auto elem = path.rbegin(); elem != path.rend(); ++elem)
+        {
+            const node* original = *elem;
+            new_child = value > original->value_
+                            ? node_ptr(new node(original->value_, original->left_, std::move(new_child)))
+                            : node_ptr(new node(original->value_, std::move(new_child), original->right_));
+        }
+        return new_child;
+    }
+
+    std::pair<node_ptr, size_t> current_version() const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex_);
+        return {root_, size_};
+    }
+
+    // returns the replaced version: releasing it might free a lot of nodes, so the writers do it
+    // outside of both locks
+    node_ptr publish(node_ptr root, const size_t size)
+    {
+        std::lock_guard<std::mutex> lock(version_mutex_);
+        std::swap(root_, root);
+        size_ = size;
+        return root;
+    }
+
+    // protects only the swap of the root pointer, nobody holds it for longer than a copy of shared_ptr
+    mutable std::mutex version_mutex_;
+    // serializes writers with each other
+    std::mutex write_mutex_;
+    node_ptr root_;
+    size_t size_;
+};
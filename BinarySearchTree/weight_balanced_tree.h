@@ -0,0 +1,506 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "binary_search_tree.h"
+
+// weight balanced binary search tree built on the same nodes as binary_search_tree
+// all the operations are expressed through join (merging two trees and a middle node with rebalancing),
+// which gives O(log n) add/remove/split/join and O(m log(n/m + 1)) union, intersection and difference
+// Compare defines the order like in binary_search_tree, the set operations use the comparator of the left tree
+template <typename T, typename Compare>
+class weight_balanced_tree
+{
+public:
+    using inorder_iterator = typename binary_search_tree<T, Compare>::inorder_iterator;
+
+    weight_balanced_tree() : root_(nullptr)
+    {
+    }
+
+    explicit weight_balanced_tree(const Compare& comparator) : root_(nullptr), comparator_(comparator)
+    {
+    }
+
+    weight_balanced_tree(const weight_balanced_tree& other)
+        : root_(copy_subtree(other.root_)), comparator_(other.comparator_)
+    {
+    }
+
+    weight_balanced_tree(weight_balanced_tree&& other) noexcept : root_(other.root_), comparator_(other.comparator_)
+    {
+        other.root_ = nullptr;
+    }
+
+    weight_balanced_tree& operator=(weight_balanced_tree other) noexcept
+    {
+        std::swap(root_, other.root_);
+        std::swap(comparator_, other.comparator_);
+        return *this;
+    }
+
+    bst_node<T>* root() const
+    {
+        return root_;
+    }
+
+    size_t size() const
+    {
+        return size_of(root_);
+    }
+
+    bool add(const T& value)
+    {
+        split_result parts = split_node(root_, value, comparator_);
+        // ignore duplicate values
+        const bool added = !parts.middle;
+        root_ = join_nodes(parts.left, added ? new bst_node<T>(value) : parts.middle, parts.right);
+        return added;
+    }
+
+    bool remove(const T& value)
+    {
+        split_result parts = split_node(root_, value, comparator_);
+        root_ = join_two(parts.left, parts.right);
+        if (!parts.middle)
+        {
+            return false;
+        }
+        delete parts.middle;
+        return true;
+    }
+
+    bst_node<T>* find(const T& value) const
+    {
+        bst_node<T>* current = root_;
+        while (current)
+        {
+            // right - greater values, left - lower values
+            if (comparator_(current->value_, value))
+            {
+                current = current->right_;
+            }
+            else if (comparator_(value, current->value_))
+            {
+                current = current->left_;
+            }
+            else
+            {
+                return current;
+            }
+        }
+        return nullptr;
+    }
+
+    bool contains(const T& value) const
+    {
+        return find(value) != nullptr;
+    }
+
+    void clear()
+    {
+        delete_subtree(root_);
+        root_ = nullptr;
+    }
+
+    // moves all the elements that are not lower than key to the returned tree
+    weight_balanced_tree split(const T& key)
+    {
+        std::pair<bst_node<T>*, bst_node<T>*> parts = split_lower(root_, key, comparator_);
+        root_ = parts.first;
+        return weight_balanced_tree(parts.second, comparator_);
+    }
+
+    // concatenates two trees, all the elements of left have to be lower than elements of right
+    static weight_balanced_tree join(weight_balanced_tree left, weight_balanced_tree right)
+    {
+        if (left.root_ && right.root_ &&
+            !left.comparator_(extreme_value(left.root_, true), extreme_value(right.root_, false)))
+        {
+            throw std::runtime_error("Couldn't join the trees: the left tree has elements not lower than the right one");
+        }
+
+        bst_node<T>* root = join_two(left.root_, right.root_);
+        left.root_ = right.root_ = nullptr;
+        return weight_balanced_tree(root, left.comparator_);
+    }
+
+    // removes all the elements of range [lo, hi), returns the number of removed elements
+    size_t erase_range(const T& lo, const T& hi)
+    {
+        if (!comparator_(lo, hi))
+        {
+            return 0;
+        }
+
+        std::pair<bst_node<T>*, bst_node<T>*> lower = split_lower(root_, lo, comparator_);
+        std::pair<bst_node<T>*, bst_node<T>*> upper = split_lower(lower.second, hi, comparator_);
+        const size_t erased = size_of(upper.first);
+        delete_subtree(upper.first);
+        root_ = join_two(lower.first, upper.second);
+        return erased;
+    }
+
+    // SET OPERATIONS
+    // the arguments are taken by value: pass temporaries (or std::move) to reuse their nodes without copying
+    // the recursive halves of big inputs are processed in parallel: fork_depth is the number of recursion levels
+    // that run their halves on separate threads (at most 2^fork_depth threads), 0 - sequential
+    static weight_balanced_tree set_union(weight_balanced_tree left, weight_balanced_tree right,
+                                          const size_t fork_depth = parallel_depth())
+    {
+        bst_node<T>* root = union_nodes(left.release(), right.release(), fork_depth, left.comparator_);
+        return weight_balanced_tree(root, left.comparator_);
+    }
+
+    static weight_balanced_tree set_intersection(weight_balanced_tree left, weight_balanced_tree right,
+                                                 const size_t fork_depth = parallel_depth())
+    {
+        bst_node<T>* root = intersection_nodes(left.release(), right.release(), fork_depth, left.comparator_);
+        return weight_balanced_tree(root, left.comparator_);
+    }
+
+    // elements of left that are not present in right
+    static weight_balanced_tree set_difference(weight_balanced_tree left, weight_balanced_tree right,
+                                               const size_t fork_depth = parallel_depth())
+    {
+        bst_node<T>* root = difference_nodes(left.release(), right.release(), fork_depth, left.comparator_);
+        return weight_balanced_tree(root, left.comparator_);
+    }
+
+    // default fork depth of the set operations, enough to give every core some work
+    static size_t parallel_depth()
+    {
+        size_t depth = 0;
+        for (size_t threads = std::max(1u, std::thread::hardware_concurrency()); threads > 1; threads /= 2)
+        {
+            depth++;
+        }
+        return depth + 1;
+    }
+
+    // subproblems smaller than that are not worth a thread
+    static constexpr size_t parallel_threshold = 1 << 16;
+
+    inorder_iterator begin_inorder() const { return inorder_iterator(root_); }
+    inorder_iterator end_inorder() const { return inorder_iterator(nullptr); }
+
+    ~weight_balanced_tree()
+    {
+        delete_subtree(root_);
+    }
+
+private:
+    // result of the split by key: elements lower than key, node with key itself (if any), greater elements
+    struct split_result
+    {
+        bst_node<T>* left;
+        bst_node<T>* middle;
+        bst_node<T>* right;
+    };
+
+    weight_balanced_tree(bst_node<T>* root, const Compare& comparator) : root_(root), comparator_(comparator)
+    {
+    }
+
+    bst_node<T>* release()
+    {
+        bst_node<T>* root = root_;
+        root_ = nullptr;
+        return root;
+    }
+
+    // BALANCE
+    static size_t size_of(const bst_node<T>* node)
+    {
+        return node ? node->subtree_size_ : 0;
+    }
+
+    static size_t weight_of(const bst_node<T>* node)
+    {
+        return size_of(node) + 1;
+    }
+
+    // weights of siblings are balanced if each of them is at least alpha = 2/7 of their sum
+    // (alpha has to be below 1 - 1/sqrt(2) for the rotations in join to restore the balance)
+    static bool is_balanced(const size_t weight_l, const size_t weight_r)
+    {
+        return 5 * weight_l >= 2 * weight_r && 5 * weight_r >= 2 * weight_l;
+    }
+
+    // makes node the parent of left and right
+    static bst_node<T>* link(bst_node<T>* left, bst_node<T>* node, bst_node<T>* right)
+    {
+        node->left_ = left;
+        node->right_ = right;
+        node->subtree_size_ = size_of(left) + size_of(right) + 1;
+        return node;
+    }
+
+    static bst_node<T>* rotate_left(bst_node<T>* node)
+    {
+        bst_node<T>* right = node->right_;
+        link(node->left_, node, right->left_);
+        return link(node, right, right->right_);
+    }
+
+    static bst_node<T>* rotate_right(bst_node<T>* node)
+    {
+        bst_node<T>* left = node->left_;
+        link(left->right_, node, node->right_);
+        return link(left->left_, left, node);
+    }
+
+    // JOIN
+    // joins left, middle and right where all elements of left < middle < all elements of right
+    static bst_node<T>* join_nodes(bst_node<T>* left, bst_node<T>* middle, bst_node<T>* right)
+    {
+        if (is_balanced(weight_of(left), weight_of(right)))
+        {
+            return link(left, middle, right);
+        }
+        return weight_of(left) > weight_of(right) ? join_right(left, middle, right) : join_left(left, middle, right);
+    }
+
+    // left is too heavy: go down its right spine until the subtree is balanced with right
+    static bst_node<T>* join_right(bst_node<T>* left, bst_node<T>* middle, bst_node<T>* right)
+    {
+        if (is_balanced(weight_of(left), weight_of(right)))
+        {
+            return link(left, middle, right);
+        }
+
+        bst_node<T>* joined = join_right(left->right_, middle, right);
+        bst_node<T>* outer = left->left_;
+        if (is_balanced(weight_of(outer), weight_of(joined)))
+        {
+            return link(outer, left, joined);
+        }
+
+        // single rotation is enough if the inner grandchild is light
+        if (is_balanced(weight_of(outer), weight_of(joined->left_)) &&
+            is_balanced(weight_of(outer) + weight_of(joined->left_), weight_of(joined->right_)))
+        {
+            return rotate_left(link(outer, left, joined));
+        }
+        return rotate_left(link(outer, left, rotate_right(joined)));
+    }
+
+    // mirror of join_right: right is too heavy
+    static bst_node<T>* join_left(bst_node<T>* left, bst_node<T>* middle, bst_node<T>* right)
+    {
+        if (is_balanced(weight_of(left), weight_of(right)))
+        {
+            return link(left, middle, right);
+        }
+
+        bst_node<T>* joined = join_left(left, middle, right->left_);
+        bst_node<T>* outer = right->right_;
+        if (is_balanced(weight_of(joined), weight_of(outer)))
+        {
+            return link(joined, right, outer);
+        }
+
+        if (is_balanced(weight_of(joined->right_), weight_of(outer)) &&
+            is_balanced(weight_of(joined->left_), weight_of(joined->right_) + weight_of(outer)))
+        {
+            return rotate_right(link(joined, right, outer));
+        }
+        return rotate_right(link(rotate_left(joined), right, outer));
+    }
+
+    // joins two trees without a middle node: the max of left becomes the middle
+    static bst_node<T>* join_two(bst_node<T>* left, bst_node<T>* right)
+    {
+        if (!left)
+        {
+            return right;
+        }
+        std::pair<bst_node<T>*, bst_node<T>*> parts = split_last(left);
+        return join_nodes(parts.first, parts.second, right);
+    }
+
+    // detaches the max element of the subtree, returns the rest of the subtree and the max node
+    static std::pair<bst_node<T>*, bst_node<T>*> split_last(bst_node<T>* node)
+    {
+        if (!node->right_)
+        {
+            bst_node<T>* rest = node->left_;
+            return {rest, link(nullptr, node, nullptr)};
+        }
+        std::pair<bst_node<T>*, bst_node<T>*> parts = split_last(node->right_);
+        return {join_nodes(node->left_, node, parts.first), parts.second};
+    }
+
+    // SPLIT
+    static split_result split_node(bst_node<T>* node, const T& key, const Compare& comparator)
+    {
+        if (!node)
+        {
+            return {nullptr, nullptr, nullptr};
+        }
+
+        bst_node<T>* left = node->left_;
+        bst_node<T>* right = node->right_;
+
+        // right - greater values, left - lower values
+        if (comparator(node->value_, key))
+        {
+            split_result parts = split_node(right, key, comparator);
+            return {join_nodes(left, node, parts.left), parts.middle, parts.right};
+        }
+        if (comparator(key, node->value_))
+        {
+            split_result parts = split_node(left, key, comparator);
+            return {parts.left, parts.middle, join_nodes(parts.right, node, right)};
+        }
+        return {left, link(nullptr, node, nullptr), right};
+    }
+
+    // splits into elements lower than key and the rest
+    static std::pair<bst_node<T>*, bst_node<T>*> split_lower(bst_node<T>* node, const T& key,
+                                                             const Compare& comparator)
+    {
+        split_result parts = split_node(node, key, comparator);
+        if (parts.middle)
+        {
+            // key is the min of the upper part
+            return {parts.left, join_nodes(nullptr, parts.middle, parts.right)};
+        }
+        return {parts.left, parts.right};
+    }
+
+    // SET OPERATIONS
+    // runs both halves of the recursion, the left one on another thread if the input is big enough
+    // the halves get the fork depth of the next level: one less, but never below 0
+    template <typename LeftFunc, typename RightFunc>
+    static std::pair<bst_node<T>*, bst_node<T>*> fork_join(const size_t input_size, const size_t depth,
+                                                            LeftFunc left_func, RightFunc right_func)
+    {
+        const size_t child_depth = depth == 0 ? 0 : depth - 1;
+        if (depth == 0 || input_size < parallel_threshold)
+        {
+            bst_node<T>* left = left_func(child_depth);
+            return {left, right_func(child_depth)};
+        }
+
+        std::future<bst_node<T>*> left = std::async(std::launch::async, left_func, child_depth);
+        bst_node<T>* right = right_func(child_depth);
+        return {left.get(), right};
+    }
+
+    static bst_node<T>* union_nodes(bst_node<T>* a, bst_node<T>* b, const size_t depth, const Compare& comparator)
+    {
+        if (!a)
+        {
+            return b;
+        }
+        if (!b)
+        {
+            return a;
+        }
+
+        const size_t input_size = size_of(a) + size_of(b);
+        bst_node<T>* a_left = a->left_;
+        bst_node<T>* a_right = a->right_;
+        split_result parts = split_node(b, a->value_, comparator);
+        // duplicate of the value that stays in a
+        delete parts.middle;
+
+        std::pair<bst_node<T>*, bst_node<T>*> halves = fork_join(
+            input_size, depth,
+            [=, &comparator](const size_t child_depth) { return union_nodes(a_left, parts.left, child_depth, comparator); },
+            [=, &comparator](const size_t child_depth) { return union_nodes(a_right, parts.right, child_depth, comparator); });
+        return join_nodes(halves.first, a, halves.second);
+    }
+
+    static bst_node<T>* intersection_nodes(bst_node<T>* a, bst_node<T>* b, const size_t depth,
+                                           const Compare& comparator)
+    {
+        if (!a || !b)
+        {
+            delete_subtree(a);
+            delete_subtree(b);
+            return nullptr;
+        }
+
+        const size_t input_size = size_of(a) + size_of(b);
+        bst_node<T>* a_left = a->left_;
+        bst_node<T>* a_right = a->right_;
+        split_result parts = split_node(b, a->value_, comparator);
+
+        std::pair<bst_node<T>*, bst_node<T>*> halves = fork_join(
+            input_size, depth,
+            [=, &comparator](const size_t child_depth) { return intersection_nodes(a_left, parts.left, child_depth, comparator); },
+            [=, &comparator](const size_t child_depth) { return intersection_nodes(a_right, parts.right, child_depth, comparator); });
+
+        if (parts.middle)
+        {
+            delete parts.middle;
+            return join_nodes(halves.first, a, halves.second);
+        }
+        delete a;
+        return join_two(halves.first, halves.second);
+    }
+
+    static bst_node<T>* difference_nodes(bst_node<T>* a, bst_node<T>* b, const size_t depth,
+                                         const Compare& comparator)
+    {
+        if (!a || !b)
+        {
+            delete_subtree(b);
+            return a;
+        }
+
+        const size_t input_size = size_of(a) + size_of(b);
+        bst_node<T>* b_left = b->left_;
+        bst_node<T>* b_right = b->right_;
+        split_result parts = split_node(a, b->value_, comparator);
+        delete parts.middle;
+        delete b;
+
+        std::pair<bst_node<T>*, bst_node<T>*> halves = fork_join(
+            input_size, depth,
+            [=, &comparator](const size_t child_depth) { return difference_nodes(parts.left, b_left, child_depth, comparator); },
+            [=, &comparator](const size_t child_depth) { return difference_nodes(parts.right, b_right, child_depth, comparator); });
+        return join_two(halves.first, halves.second);
+    }
+
+    // HELPERS
+    static const T& extreme_value(const bst_node<T>* node, const bool max_value)
+    {
+        while (max_value ? node->right_ : node->left_)
+        {
+            node = max_value ? node->right_ : node->left_;
+        }
+        return node->value_;
+    }
+
+    static bst_node<T>* copy_subtree(const bst_node<T>* node)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+        bst_node<T>* copy = new bst_node<T>(node->value_);
+        return link(copy_subtree(node->left_), copy, copy_subtree(node->right_));
+    }
+
+    // recursion depth is bounded by the height, which is logarithmic here
+    static void delete_subtree(bst_node<T>* node)
+    {
+        if (!node)
+        {
+            return;
+        }
+        delete_subtree(node->left_);
+        delete_subtree(node->right_);
+        delete node;
+    }
+
+    bst_node<T>* root_;
+    Compare comparator_;
+};
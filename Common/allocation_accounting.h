@@ -0,0 +1,223 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// accounting of the memory allocated by the containers and the sorts: live and peak bytes, allocation counts
+// and a histogram of the allocation sizes, per container instance and globally
+// it's compiled only if ENABLE_ALLOCATION_ACCOUNTING is defined, otherwise the containers don't even keep
+// an account and their allocations() return empty stats
+// only the memory of the container itself is counted (nodes, buffers), not the memory owned by the values
+
+// number of the power of two buckets of the size histogram
+constexpr size_t allocation_size_buckets = 32;
+
+struct allocation_stats
+{
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    // total bytes of all the allocations
+    uint64_t allocated_bytes = 0;
+    uint64_t live_bytes = 0;
+    uint64_t peak_bytes = 0;
+    // size_histogram[i] - number of allocations of [2^i, 2^(i+1)) bytes, the last bucket takes all the bigger ones
+    std::vector<uint64_t> size_histogram = std::vector<uint64_t>(allocation_size_buckets, 0);
+
+    // writes the stats in the Prometheus text format, one metric per line (like bst_stats)
+    void dump(std::ostream& os, const std::string& prefix = "memory") const
+    {
+        os << prefix << "_allocations " << allocations << '\n';
+        os << prefix << "_deallocations " << deallocations << '\n';
+        os << prefix << "_allocated_bytes " << allocated_bytes << '\n';
+        os << prefix << "_live_bytes " << live_bytes << '\n';
+        os << prefix << "_peak_bytes " << peak_bytes << '\n';
+        for (size_t bucket = 0; bucket < size_histogram.size(); ++bucket)
+        {
+            // empty buckets would only clutter the output
+            if (size_histogram[bucket] > 0)
+            {
+                os << prefix << "_allocation_size{min_bytes=\"" << (uint64_t{1} << bucket) << "\"} "
+                   << size_histogram[bucket] << '\n';
+            }
+        }
+    }
+};
+
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+
+// counters of one owner, thread-safe (relaxed atomics)
+// every instance account also reports into the global one, which sees all the accounted allocations
+class allocation_account
+{
+public:
+    allocation_account() : parent_(&global())
+    {
+    }
+
+    allocation_account(const allocation_account& other) = delete;
+    allocation_account& operator=(const allocation_account& other) = delete;
+
+    static allocation_account& global()
+    {
+        static allocation_account account(nullptr);
+        return account;
+    }
+
+    void record_allocation(const size_t bytes)
+    {
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        size_histogram_[size_bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+        add_live_bytes(bytes);
+        if (parent_)
+        {
+            parent_->record_allocation(bytes);
+        }
+    }
+
+    void record_deallocation(const size_t bytes)
+    {
+        deallocations_.fetch_add(1, std::memory_order_relaxed);
+        live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        if (parent_)
+        {
+            parent_->record_deallocation(bytes);
+        }
+    }
+
+    // the memory was handed over from other to this owner (moved or spliced nodes):
+    // the live bytes go with it, the allocations stay in the history of other, the global account doesn't change
+    void transfer_from(allocation_account& other, const size_t bytes)
+    {
+        if (bytes == 0 || &other == this)
+        {
+            return;
+        }
+        other.live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        add_live_bytes(bytes);
+    }
+
+    allocation_stats stats() const
+    {
+        allocation_stats result;
+        result.allocations = allocations_.load(std::memory_order_relaxed);
+        result.deallocations = deallocations_.load(std::memory_order_relaxed);
+        result.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+        result.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+        result.peak_bytes = peak_bytes_.load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket < allocation_size_buckets; ++bucket)
+        {
+            result.size_histogram[bucket] = size_histogram_[bucket].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    // starts a new measurement period: the counters are zeroed and the peak drops to the current live bytes
+    // (the live bytes are kept, the memory is still there)
+    void reset()
+    {
+        allocations_.store(0, std::memory_order_relaxed);
+        deallocations_.store(0, std::memory_order_relaxed);
+        allocated_bytes_.store(0, std::memory_order_relaxed);
+        peak_bytes_.store(live_bytes_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        for (auto& bucket : size_histogram_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    explicit allocation_account(allocation_account* parent) : parent_(parent)
+    {
+    }
+
+    void add_live_bytes(const size_t bytes)
+    {
+        const uint64_t live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static size_t size_bucket(size_t bytes)
+    {
+        size_t bucket = 0;
+        while (bytes > 1 && bucket < allocation_size_buckets - 1)
+        {
+            bytes >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    allocation_account* parent_;
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> deallocations_{0};
+    std::atomic<uint64_t> allocated_bytes_{0};
+    std::atomic<uint64_t> live_bytes_{0};
+    std::atomic<uint64_t> peak_bytes_{0};
+    std::atomic<uint64_t> size_histogram_[allocation_size_buckets] = {};
+};
+
+// std allocator for the temporary buffers (e.g. of merge_sort), reports into the global account
+template <typename T>
+class accounting_allocator
+{
+public:
+    using value_type = T;
+
+    accounting_allocator() = default;
+
+    template <typename U>
+    accounting_allocator(const accounting_allocator<U>&)
+    {
+    }
+
+    T* allocate(const size_t count)
+    {
+        T* memory = std::allocator<T>().allocate(count);
+        allocation_account::global().record_allocation(count * sizeof(T));
+        return memory;
+    }
+
+    void deallocate(T* memory, const size_t count)
+    {
+        allocation_account::global().record_deallocation(count * sizeof(T));
+        std::allocator<T>().deallocate(memory, count);
+    }
+
+    template <typename U>
+    bool operator==(const accounting_allocator<U>&) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const accounting_allocator<U>&) const
+    {
+        return false;
+    }
+};
+
+// stats of all the accounted allocations of the process
+inline allocation_stats global_allocation_stats()
+{
+    return allocation_account::global().stats();
+}
+
+#else
+
+template <typename T>
+using accounting_allocator = std::allocator<T>;
+
+inline allocation_stats global_allocation_stats()
+{
+    return allocation_stats();
+}
+
+#endif
@@ -0,0 +1,252 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// epoch based memory reclamation for lock-free readers
+// readers mark the critical section with epoch_domain::guard, writers unlink the nodes and retire them
+// retired nodes are deleted only after every reader that could have seen them has left its critical section:
+// the epoch advances only when every reader inside has seen the current one, so two epochs after the retire
+// no reader can hold the node; retire and reclaim never wait for the readers
+class epoch_domain
+{
+public:
+    // upper bound for the number of threads that are registered in the domain at the same time
+    static constexpr size_t max_threads = 512;
+    // amount of retired objects that triggers the reclamation
+    static constexpr size_t reclaim_threshold = 1024;
+
+    // all the lock-free containers share one domain, so a thread needs only one slot
+    static epoch_domain& global()
+    {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    // RAII marker of the reader critical section, guards can be nested
+    class guard
+    {
+    public:
+        explicit guard(epoch_domain& domain = global()) : domain_(domain)
+        {
+            domain_.enter();
+        }
+
+        guard(const guard& other) = delete;
+        guard& operator=(const guard& other) = delete;
+
+        ~guard()
+        {
+            domain_.leave();
+        }
+
+    private:
+        epoch_domain& domain_;
+    };
+
+    // blocks until all the readers that entered their critical sections before the call have left them
+    // must not be called from inside of the critical section (it would wait for itself)
+    void synchronize()
+    {
+        if (local_state().depth > 0)
+        {
+            throw std::runtime_error("Couldn't synchronize epochs: called inside of the reader critical section");
+        }
+
+        // after two advances every reader that was inside at the call has left
+        const uint64_t target = epoch_.load(std::memory_order_acquire) + 2;
+        while (epoch_.load(std::memory_order_acquire) < target)
+        {
+            if (!try_advance())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // schedules deletion of an object that is not reachable for new readers anymore
+    template <typename U>
+    void retire(U* ptr)
+    {
+        retire(ptr, [](void* to_delete) { delete static_cast<U*>(to_delete); });
+    }
+
+    // never blocks: the object goes to the limbo list of the calling thread together with the current epoch,
+    // every reclaim_threshold retires the thread tries to advance the epoch and frees what became safe
+    void retire(void* ptr, void (*deleter)(void*))
+    {
+        local_slot& state = local_state();
+
+        // pairs with the fence in enter(): a reader that can still see the object is not past this epoch
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        state.limbo.push_back({ptr, deleter, epoch_.load(std::memory_order_relaxed)});
+        if (++state.retired_since_reclaim >= reclaim_threshold)
+        {
+            reclaim();
+        }
+    }
+
+    // frees the objects of the calling thread (and the ones left by the finished threads) retired at least
+    // two epochs ago, after trying to advance the epoch; doesn't wait for the readers, so it can free nothing
+    void reclaim()
+    {
+        local_slot& state = local_state();
+        state.retired_since_reclaim = 0;
+        adopt_orphans(state);
+        try_advance();
+
+        // no reader can be in the critical section that started two epochs before the current one
+        const uint64_t current = epoch_.load(std::memory_order_acquire);
+        // taken out, so that a deleter can retire objects itself
+        std::vector<retired_object> pending;
+        pending.swap(state.limbo);
+        for (const auto& object : pending)
+        {
+            if (object.epoch + 2 <= current)
+            {
+                object.deleter(object.ptr);
+            }
+            else
+            {
+                state.limbo.push_back(object);
+            }
+        }
+    }
+
+    ~epoch_domain()
+    {
+        // no readers are left at the static destruction time, the limbo lists of the threads are orphaned by now
+        for (auto& object : orphans_)
+        {
+            object.deleter(object.ptr);
+        }
+    }
+
+private:
+    struct alignas(64) thread_slot
+    {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> used{false};
+    };
+
+    struct retired_object
+    {
+        void* ptr;
+        void (*deleter)(void*);
+        // epoch at the moment of the retire
+        uint64_t epoch;
+    };
+
+    // slot and limbo list of the current thread, released when the thread exits
+    struct local_slot
+    {
+        thread_slot* slot = nullptr;
+        size_t depth = 0;
+        std::vector<retired_object> limbo;
+        size_t retired_since_reclaim = 0;
+
+        ~local_slot()
+        {
+            if (slot)
+            {
+                slot->used.store(false, std::memory_order_release);
+            }
+            // objects that are not safe to free yet are left to the other threads
+            if (!limbo.empty())
+            {
+                epoch_domain& domain = global();
+                std::lock_guard<std::mutex> lock(domain.orphans_mutex_);
+                domain.orphans_.insert(domain.orphans_.end(), limbo.begin(), limbo.end());
+            }
+        }
+    };
+
+    epoch_domain() = default;
+
+    local_slot& local_state()
+    {
+        thread_local local_slot state;
+        return state;
+    }
+
+    thread_slot* acquire_slot()
+    {
+        for (auto& slot : slots_)
+        {
+            bool expected = false;
+            if (!slot.used.load(std::memory_order_relaxed) &&
+                slot.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                return &slot;
+            }
+        }
+        throw std::runtime_error("Couldn't register the thread: all epoch slots are in use");
+    }
+
+    void enter()
+    {
+        local_slot& state = local_state();
+        if (state.depth++ > 0)
+        {
+            return;
+        }
+        if (!state.slot)
+        {
+            state.slot = acquire_slot();
+        }
+
+        state.slot->epoch.store(epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // moves the epoch one step forward if every reader inside of the critical section has seen the current one
+    // returns false if some reader is still behind
+    bool try_advance()
+    {
+        uint64_t current = epoch_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto& slot : slots_)
+        {
+            const uint64_t observed = slot.epoch.load(std::memory_order_acquire);
+            if (observed != 0 && observed != current)
+            {
+                return false;
+            }
+        }
+        // failure means that another thread has advanced it
+        epoch_.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire);
+        return true;
+    }
+
+    // takes the objects left by the finished threads, skipped if another thread is doing the same
+    void adopt_orphans(local_slot& state)
+    {
+        std::unique_lock<std::mutex> lock(orphans_mutex_, std::try_to_lock);
+        if (lock.owns_lock() && !orphans_.empty())
+        {
+            state.limbo.insert(state.limbo.end(), orphans_.begin(), orphans_.end());
+            orphans_.clear();
+        }
+    }
+
+    void leave()
+    {
+        local_slot& state = local_state();
+        if (--state.depth == 0)
+        {
+            state.slot->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    // starts from 1 since 0 in the slot means that the thread is not inside of the critical section
+    std::atomic<uint64_t> epoch_{1};
+    thread_slot slots_[max_threads];
+
+    // limbo lists of the finished threads, touched only at thread exit and with try_lock in reclaim
+    std::mutex orphans_mutex_;
+    std::vector<retired_object> orphans_;
+};
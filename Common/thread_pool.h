@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads executing submitted tasks in FIFO order
+// tasks must not wait for other tasks of the same pool: split the work up front instead
+class thread_pool
+{
+public:
+    explicit thread_pool(const size_t threads = default_size()) : stopping_(false)
+    {
+        for (size_t idx = 0; idx < std::max<size_t>(threads, 1); ++idx)
+        {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    thread_pool(const thread_pool& other) = delete;
+    thread_pool& operator=(const thread_pool& other) = delete;
+
+    // pool shared by the parallel algorithms of the repo, one thread per core
+    static thread_pool& shared()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    static size_t default_size()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    size_t size() const
+    {
+        return workers_.size();
+    }
+
+    // schedules the task, the result (or the exception) is delivered through the future
+    template <typename Func>
+    auto submit(Func func) -> std::future<decltype(func())>
+    {
+        using result_type = decltype(func());
+        // packaged_task is move-only, std::function needs a copyable callable
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::move(func));
+        std::future<result_type> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([task] { (*task)(); });
+        }
+        has_tasks_.notify_one();
+        return result;
+    }
+
+    // waits for the queued tasks to finish
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        has_tasks_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+private:
+    void worker_loop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                has_tasks_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    bool stopping_;
+};
@@ -0,0 +1,1053 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "append_only_log.h"
+#include "concurrent_queue.h"
+#include "indexed_singly_linked_list.h"
+#include "intrusive_singly_linked_list.h"
+#include "node_allocators.h"
+#include "singly_linked_list.h"
+#include "skip_list.h"
+#include "unrolled_linked_list.h"
+
+// value that counts its live instances and throws when the copy of throw_value is made
+struct counted_value
+{
+    explicit counted_value(const int initial) : value(initial)
+    {
+        live++;
+    }
+
+    counted_value(const counted_value& other) : value(other.value)
+    {
+        if (value == throw_value)
+        {
+            throw std::runtime_error("copy failed");
+        }
+        live++;
+    }
+
+    ~counted_value()
+    {
+        live--;
+    }
+
+    int value;
+    static int live;
+    static int throw_value;
+};
+
+int counted_value::live = 0;
+int counted_value::throw_value = -1;
+
+// number of the failed checks, main returns nonzero if there are any
+int failed_checks = 0;
+
+void report(const std::string& name, const bool passed)
+{
+    std::cout << name << ": " << (passed ? "passed" : "FAILED") << std::endl;
+    failed_checks += passed ? 0 : 1;
+}
+
+// the list has the elements of the reference in the same order
+template <typename List, typename T>
+bool same_elements(List& list, const std::list<T>& reference)
+{
+    auto expected = reference.begin();
+    for (auto elem = list.begin(); elem != list.end(); ++elem, ++expected)
+    {
+        if (expected == reference.end() || !(*elem == *expected))
+        {
+            return false;
+        }
+    }
+    return expected == reference.end();
+}
+
+// pushes at both ends of the list and of the reference and compares them, a stale head or tail shows up here
+template <typename List>
+bool same_after_pushes(List& list, std::list<int>& reference)
+{
+    list.push_back(-1);
+    list.push_forward(-2);
+    reference.push_back(-1);
+    reference.push_front(-2);
+    return list.length() == reference.size() && same_elements(list, reference);
+}
+
+// the queue works with the values that can only be moved
+bool check_queue_move_only()
+{
+    concurrent_queue<std::unique_ptr<int>> queue;
+    for (int value = 0; value < 10; ++value)
+    {
+        queue.push(std::make_unique<int>(value));
+    }
+
+    bool passed = true;
+    std::optional<std::unique_ptr<int>> front = queue.try_pop();
+    passed = passed && front && **front == 0;
+
+    std::vector<std::unique_ptr<int>> popped;
+    passed = passed && queue.pop_many(std::back_inserter(popped), 5) == 5;
+    for (size_t idx = 0; idx < popped.size(); ++idx)
+    {
+        passed = passed && *popped[idx] == static_cast<int>(idx) + 1;
+    }
+
+    int expected = 6;
+    while (auto value = queue.try_pop())
+    {
+        passed = passed && **value == expected++;
+    }
+    return passed && expected == 10 && queue.empty();
+}
+
+// every pushed value is popped exactly once when producers and consumers run at the same time,
+// enough pops to make the epoch domain reclaim the retired nodes on the consumer threads
+bool check_queue_concurrent()
+{
+    constexpr int producers = 2;
+    constexpr int consumers = 2;
+    constexpr int per_producer = 20000;
+
+    concurrent_queue<std::unique_ptr<int>> queue;
+    std::vector<std::vector<int>> popped(consumers);
+    std::atomic<int> remaining(producers * per_producer);
+
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&queue, producer] {
+            for (int value = 0; value < per_producer; ++value)
+            {
+                queue.push(std::make_unique<int>(producer * per_producer + value));
+            }
+        });
+    }
+    for (int consumer = 0; consumer < consumers; ++consumer)
+    {
+        threads.emplace_back([&queue, &popped, &remaining, consumer] {
+            while (remaining.load() > 0)
+            {
+                std::vector<std::unique_ptr<int>> batch;
+                if (consumer == 0)
+                {
+                    if (auto value = queue.try_pop())
+                    {
+                        batch.push_back(std::move(*value));
+                    }
+                }
+                else
+                {
+                    queue.pop_many(std::back_inserter(batch), 16);
+                }
+                for (auto& value : batch)
+                {
+                    popped[consumer].push_back(*value);
+                }
+                remaining.fetch_sub(static_cast<int>(batch.size()));
+                if (batch.empty())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<int> seen(producers * per_producer, 0);
+    for (const auto& values : popped)
+    {
+        for (const int value : values)
+        {
+            seen[value]++;
+        }
+    }
+    bool passed = queue.empty();
+    for (const int times : seen)
+    {
+        passed = passed && times == 1;
+    }
+    return passed;
+}
+
+// keys that are multiples of a big power of two have the same low bits of std::hash,
+// the index has to spread them anyway and keep them findable through the backward shift deletions
+bool check_indexed_list_strided_keys()
+{
+    constexpr uint64_t stride = uint64_t{1} << 20;
+    constexpr uint64_t count = 20000;
+
+    indexed_singly_linked_list<uint64_t> list;
+    bool passed = true;
+    for (uint64_t idx = 0; idx < count; ++idx)
+    {
+        passed = passed && list.push_back(idx * stride);
+    }
+    passed = passed && !list.push_back(0) && list.length() == count;
+
+    for (uint64_t idx = 0; idx < count; idx += 2)
+    {
+        passed = passed && list.remove(idx * stride);
+    }
+    for (uint64_t idx = 0; idx < count; ++idx)
+    {
+        passed = passed && list.contains(idx * stride) == (idx % 2 == 1) && !list.contains(idx * stride + 1);
+    }
+
+    // the insertion order is kept
+    uint64_t expected = 1;
+    for (const uint64_t value : list)
+    {
+        passed = passed && value == expected * stride;
+        expected += 2;
+    }
+    return passed && expected == count + 1 && list.length() == count / 2;
+}
+
+// nodes allocated by one thread and freed by another come back to the allocating thread,
+// so the pool reuses a bounded set of slots instead of growing with every allocation
+bool check_pool_cross_thread_reuse()
+{
+    struct test_node
+    {
+        uint64_t payload[4];
+    };
+    constexpr size_t total = 200000;
+    constexpr size_t in_flight = 256;
+
+    std::mutex mutex;
+    std::vector<void*> handed_over;
+    std::atomic<bool> producer_done(false);
+    std::unordered_set<void*> addresses;
+
+    std::thread consumer([&] {
+        std::vector<void*> to_free;
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                to_free.swap(handed_over);
+            }
+            for (void* ptr : to_free)
+            {
+                pooled_node_allocator::deallocate(static_cast<test_node*>(ptr));
+            }
+            if (to_free.empty())
+            {
+                if (producer_done.load())
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (handed_over.empty())
+                    {
+                        break;
+                    }
+                }
+                std::this_thread::yield();
+            }
+            to_free.clear();
+        }
+    });
+
+    std::vector<void*> batch;
+    for (size_t idx = 0; idx < total; ++idx)
+    {
+        void* ptr = pooled_node_allocator::allocate<test_node>();
+        addresses.insert(ptr);
+        batch.push_back(ptr);
+        if (batch.size() == in_flight)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            handed_over.insert(handed_over.end(), batch.begin(), batch.end());
+            batch.clear();
+        }
+        // lets the consumer catch up, so the number of the slots in use stays bounded
+        while (idx % in_flight == 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (handed_over.size() < in_flight * 4)
+            {
+                break;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handed_over.insert(handed_over.end(), batch.begin(), batch.end());
+    }
+    producer_done.store(true);
+    consumer.join();
+
+    // without the reuse every allocation would get a new address
+    return addresses.size() < total / 4;
+}
+
+// the nodes built before a value constructor throws are freed by the range constructor
+template <typename Allocator>
+bool check_range_constructor_exception()
+{
+    std::vector<counted_value> values;
+    values.reserve(10);
+    for (int value = 0; value < 10; ++value)
+    {
+        values.emplace_back(value);
+    }
+
+    bool passed = false;
+    counted_value::throw_value = 7;
+    try
+    {
+        singly_linked_list<counted_value, Allocator> list(values.begin(), values.end());
+    }
+    catch (const std::runtime_error&)
+    {
+        passed = true;
+    }
+    counted_value::throw_value = -1;
+    return passed && counted_value::live == 10;
+}
+
+// random pushes at both ends and removals of the first occurrence give the same sequence as std::list,
+// for a type compared with SIMD and for one that is not trivially copyable
+template <typename T, typename MakeValue>
+bool check_unrolled_list(MakeValue make_value)
+{
+    constexpr int steps = 20000;
+    unrolled_linked_list<T> list;
+    std::list<T> reference;
+    std::mt19937 random(11);
+
+    bool passed = true;
+    for (int step = 0; step < steps; ++step)
+    {
+        // few distinct values, so there are duplicates to remove and to look for
+        const T value = make_value(static_cast<int>(random() % 200));
+        switch (random() % 4)
+        {
+        case 0:
+            list.push_back(value);
+            reference.push_back(value);
+            break;
+        case 1:
+            list.push_forward(value);
+            reference.push_front(value);
+            break;
+        case 2:
+        {
+            list.remove(value);
+            const auto found = std::find(reference.begin(), reference.end(), value);
+            if (found != reference.end())
+            {
+                reference.erase(found);
+            }
+            break;
+        }
+        default:
+            passed = passed &&
+                     list.contains(value) == (std::find(reference.begin(), reference.end(), value) != reference.end());
+            break;
+        }
+        if (step % 1000 == 0)
+        {
+            passed = passed && list.length() == reference.size() && same_elements(list, reference);
+        }
+    }
+    passed = passed && list.length() == reference.size() && same_elements(list, reference);
+
+    unrolled_linked_list<T> copy(list);
+    unrolled_linked_list<T> assigned;
+    assigned = copy;
+    unrolled_linked_list<T> moved(std::move(copy));
+    passed = passed && same_elements(assigned, reference) && same_elements(moved, reference) && copy.length() == 0;
+
+    // removing everything leaves no chunks behind
+    while (!reference.empty())
+    {
+        list.remove(reference.front());
+        reference.pop_front();
+    }
+    return passed && list.length() == 0 && !(list.begin() != list.end());
+}
+
+// appends (key, sequence number) pairs with random keys from a small range to both lists,
+// the sequence numbers are unique across all the lists filled by the generator
+template <typename Allocator>
+void fill_keyed(singly_linked_list<std::pair<int, int>, Allocator>& list, std::list<std::pair<int, int>>& reference,
+                const int count, std::mt19937& random)
+{
+    static int sequence = 0;
+    for (int idx = 0; idx < count; ++idx)
+    {
+        const std::pair<int, int> value(static_cast<int>(random() % 50), sequence++);
+        list.push_back(value);
+        reference.push_back(value);
+    }
+}
+
+// sort and merge compare the keys only, so the sequence numbers show that both are stable like std::list;
+// the lists stay usable at both ends after the nodes were relinked by sort, merge and splice
+template <typename Allocator>
+bool check_sort_merge_splice()
+{
+    using value_type = std::pair<int, int>;
+    using list_type = singly_linked_list<value_type, Allocator>;
+    const auto by_key = [](const value_type& l, const value_type& r) { return l.first < r.first; };
+    std::mt19937 random(12);
+
+    bool passed = true;
+    for (const int count : {0, 1, 2, 3, 17, 1000, 4097})
+    {
+        list_type list;
+        std::list<value_type> reference;
+        fill_keyed(list, reference, count, random);
+        list.sort(by_key);
+        reference.sort(by_key);
+        passed = passed && list.length() == reference.size() && same_elements(list, reference);
+
+        list_type other;
+        std::list<value_type> other_reference;
+        fill_keyed(other, other_reference, count / 2 + 1, random);
+        other.sort(by_key);
+        other_reference.sort(by_key);
+        list.merge(other, by_key);
+        reference.merge(other_reference, by_key);
+        passed = passed && list.length() == reference.size() && same_elements(list, reference) &&
+                 other.length() == 0;
+
+        list_type front, back;
+        std::list<value_type> front_reference, back_reference;
+        fill_keyed(front, front_reference, count % 5, random);
+        fill_keyed(back, back_reference, count % 3, random);
+        list.splice_front(front);
+        list.splice_back(back);
+        list.splice_back(front);
+        reference.splice(reference.begin(), front_reference);
+        reference.splice(reference.end(), back_reference);
+        passed = passed && list.length() == reference.size() && same_elements(list, reference) &&
+                 front.length() == 0 && back.length() == 0;
+
+        // the ends are right after the relinking, in the list and in the emptied ones
+        for (list_type* target : {&list, &other, &back})
+        {
+            target->push_back(value_type(-1, -1));
+            target->push_forward(value_type(-2, -2));
+        }
+        reference.push_back(value_type(-1, -1));
+        reference.push_front(value_type(-2, -2));
+        const std::list<value_type> ends{value_type(-2, -2), value_type(-1, -1)};
+        passed = passed && same_elements(list, reference) && same_elements(other, ends) && same_elements(back, ends);
+    }
+    return passed;
+}
+
+// remove_if, remove_all, unique and partition give the same sequences and counts as std::list
+// (and std::stable_partition) and leave the ends of the list right, a predicate that throws
+// in the middle of the pass leaves every value either in the list or in the removed ones
+template <typename Allocator>
+bool check_remove_unique_partition()
+{
+    using list_type = singly_linked_list<int, Allocator>;
+    std::mt19937 random(13);
+
+    bool passed = true;
+    for (const int count : {0, 1, 2, 10, 1000})
+    {
+        std::list<int> original;
+        for (int idx = 0; idx < count; ++idx)
+        {
+            // runs of equal values for unique
+            original.push_back(static_cast<int>(random() % 8) / 3);
+            if (random() % 4 == 0)
+            {
+                original.push_back(static_cast<int>(random() % 100));
+            }
+        }
+        const auto is_odd = [](const int value) { return value % 2 != 0; };
+
+        list_type list(original.begin(), original.end());
+        std::list<int> reference = original;
+        list_type removed;
+        passed = passed && list.remove_if(is_odd, removed) == static_cast<size_t>(std::count_if(
+                                                                    original.begin(), original.end(), is_odd));
+        reference.remove_if(is_odd);
+        std::list<int> removed_reference;
+        std::copy_if(original.begin(), original.end(), std::back_inserter(removed_reference), is_odd);
+        passed = passed && same_elements(list, reference) && same_elements(removed, removed_reference) &&
+                 list.length() == reference.size() && removed.length() == removed_reference.size();
+        passed = passed && same_after_pushes(list, reference) && same_after_pushes(removed, removed_reference);
+
+        list = list_type(original.begin(), original.end());
+        reference = original;
+        passed = passed && list.remove_all(0) == static_cast<size_t>(std::count(original.begin(), original.end(), 0));
+        reference.remove(0);
+        passed = passed && same_elements(list, reference) && same_after_pushes(list, reference);
+
+        list = list_type(original.begin(), original.end());
+        reference = original;
+        reference.unique();
+        passed = passed && list.unique() == original.size() - reference.size();
+        passed = passed && same_elements(list, reference) && list.length() == reference.size();
+        // equal parity is not equality, the kept value of the group is compared with the next ones
+        const auto same_parity = [](const int l, const int r) { return l % 2 == r % 2; };
+        list.unique(same_parity);
+        reference.unique(same_parity);
+        passed = passed && same_elements(list, reference) && same_after_pushes(list, reference);
+
+        list = list_type(original.begin(), original.end());
+        std::vector<int> partitioned(original.begin(), original.end());
+        const auto is_small = [](const int value) { return value < 2; };
+        passed = passed && list.partition(is_small) ==
+                               static_cast<size_t>(std::stable_partition(partitioned.begin(), partitioned.end(),
+                                                                         is_small) - partitioned.begin());
+        reference.assign(partitioned.begin(), partitioned.end());
+        passed = passed && same_elements(list, reference) && same_after_pushes(list, reference);
+
+        // the predicate throws on the tenth call
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            list = list_type(original.begin(), original.end());
+            removed.clear();
+            int calls = 0;
+            const auto throwing_odd = [&calls](const int value)
+            {
+                if (++calls == 10)
+                {
+                    throw std::runtime_error("predicate failed");
+                }
+                return value % 2 != 0;
+            };
+            try
+            {
+                if (pass == 0)
+                {
+                    list.remove_if(throwing_odd, removed);
+                }
+                else
+                {
+                    list.partition(throwing_odd);
+                }
+                passed = passed && count < 10;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+            std::vector<int> left;
+            for (const int value : list)
+            {
+                left.push_back(value);
+            }
+            for (const int value : removed)
+            {
+                left.push_back(value);
+            }
+            std::vector<int> expected(original.begin(), original.end());
+            std::sort(left.begin(), left.end());
+            std::sort(expected.begin(), expected.end());
+            passed = passed && left == expected && list.length() + removed.length() == original.size();
+            list.push_back(-1);
+            passed = passed && list.length() + removed.length() == original.size() + 1;
+        }
+    }
+    return passed;
+}
+
+// the lists written to a stream or a descriptor and read back have the values of std::list, also at the sizes
+// around the I/O block of 1 << 16 values and with several lists in one stream; truncated streams and streams
+// of another value type are rejected
+template <typename Allocator>
+bool check_binary_round_trip()
+{
+    using list_type = singly_linked_list<int64_t, Allocator>;
+    const std::vector<size_t> sizes{0, 1, 3, (1 << 16) - 1, 1 << 16, (1 << 16) + 1, 150000};
+    std::mt19937_64 random(14);
+
+    std::vector<list_type> lists;
+    std::vector<std::list<int64_t>> references;
+    for (const size_t size : sizes)
+    {
+        lists.emplace_back();
+        references.emplace_back();
+        for (size_t idx = 0; idx < size; ++idx)
+        {
+            const int64_t value = static_cast<int64_t>(random());
+            lists.back().push_back(value);
+            references.back().push_back(value);
+        }
+    }
+
+    bool passed = true;
+    std::stringstream stream;
+    for (const list_type& list : lists)
+    {
+        list.write(stream);
+    }
+    for (std::list<int64_t>& reference : references)
+    {
+        list_type read = list_type::read(stream);
+        passed = passed && read.length() == reference.size() && same_elements(read, reference);
+    }
+    passed = passed && stream.peek() == std::char_traits<char>::eof();
+
+#ifndef _WIN32
+    if (std::FILE* file = std::tmpfile())
+    {
+        const int fd = fileno(file);
+        for (const list_type& list : lists)
+        {
+            list.write(fd);
+        }
+        passed = passed && lseek(fd, 0, SEEK_SET) == 0;
+        for (std::list<int64_t>& reference : references)
+        {
+            list_type read = list_type::read(fd);
+            passed = passed && read.length() == reference.size() && same_elements(read, reference);
+        }
+        std::fclose(file);
+    }
+#endif
+
+    // a stream cut in the middle of the values, in the middle of the header, and a stream of 32 bit values
+    std::stringstream full;
+    lists.back().write(full);
+    const std::string bytes = full.str();
+    std::stringstream of_ints;
+    singly_linked_list<int32_t, Allocator>(references[2].begin(), references[2].end()).write(of_ints);
+    for (const std::string& broken : {bytes.substr(0, bytes.size() - 1), bytes.substr(0, 4), of_ints.str()})
+    {
+        std::stringstream broken_stream(broken);
+        try
+        {
+            list_type::read(broken_stream);
+            passed = false;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+    return passed;
+}
+
+// object that can be in two intrusive lists at once
+struct hooked_item
+{
+    int value = 0;
+    sll_hook<hooked_item> first_hook;
+    sll_hook<hooked_item> second_hook;
+};
+
+// the intrusive list links the same objects as the std::list of their addresses, with the right ends
+template <typename List>
+bool same_objects(List& list, const std::list<hooked_item*>& reference)
+{
+    bool passed = list.length() == reference.size() &&
+                  list.front() == (reference.empty() ? nullptr : reference.front()) &&
+                  list.back() == (reference.empty() ? nullptr : reference.back());
+    auto expected = reference.begin();
+    for (hooked_item& object : list)
+    {
+        passed = passed && expected != reference.end() && &object == *expected;
+        ++expected;
+    }
+    return passed && expected == reference.end();
+}
+
+// one random link or unlink of a random object, mirrored in the reference; false if the list disagrees
+template <sll_hook<hooked_item> hooked_item::*Member>
+bool run_intrusive_list_steps(intrusive_singly_linked_list<hooked_item, Member>& list,
+                              std::list<hooked_item*>& reference, std::vector<hooked_item>& objects,
+                              std::mt19937& random)
+{
+    hooked_item& object = objects[random() % objects.size()];
+    const auto position = std::find(reference.begin(), reference.end(), &object);
+    const bool linked = position != reference.end();
+    bool passed = list.contains(object) == linked;
+    switch (random() % 5)
+    {
+    case 0:
+        if (!linked)
+        {
+            list.push_back(object);
+            reference.push_back(&object);
+        }
+        break;
+    case 1:
+        if (!linked)
+        {
+            list.push_forward(object);
+            reference.push_front(&object);
+        }
+        break;
+    case 2:
+        // after a random linked object or at the head
+        if (!linked)
+        {
+            auto pred = reference.begin();
+            std::advance(pred, static_cast<long>(random() % (reference.size() + 1)));
+            if (pred == reference.begin())
+            {
+                list.insert_after(nullptr, object);
+                reference.push_front(&object);
+            }
+            else
+            {
+                list.insert_after(*std::prev(pred), object);
+                reference.insert(pred, &object);
+            }
+        }
+        break;
+    case 3:
+        if (linked)
+        {
+            const auto next = std::next(position);
+            passed = passed && list.remove_after(&object) == (next == reference.end() ? nullptr : *next);
+            if (next != reference.end())
+            {
+                reference.erase(next);
+            }
+        }
+        else
+        {
+            passed = passed && list.pop_front() == (reference.empty() ? nullptr : reference.front());
+            if (!reference.empty())
+            {
+                reference.pop_front();
+            }
+        }
+        break;
+    default:
+        passed = passed && list.remove(object) == linked;
+        if (linked)
+        {
+            reference.erase(position);
+        }
+        break;
+    }
+    return passed;
+}
+
+// random links and unlinks of the same objects in two intrusive lists over different hooks
+// give the same sequences as std::list of the object addresses, the lists don't disturb each other
+bool check_intrusive_list()
+{
+    std::vector<hooked_item> objects(64);
+    for (size_t idx = 0; idx < objects.size(); ++idx)
+    {
+        objects[idx].value = static_cast<int>(idx);
+    }
+
+    intrusive_singly_linked_list<hooked_item, &hooked_item::first_hook> first;
+    intrusive_singly_linked_list<hooked_item, &hooked_item::second_hook> second;
+    std::list<hooked_item*> first_reference, second_reference;
+    std::mt19937 random(15);
+
+    bool passed = true;
+    for (int step = 0; step < 20000; ++step)
+    {
+        passed = passed && run_intrusive_list_steps(first, first_reference, objects, random);
+        passed = passed && run_intrusive_list_steps(second, second_reference, objects, random);
+        if (step % 100 == 0)
+        {
+            passed = passed && same_objects(first, first_reference) && same_objects(second, second_reference);
+        }
+    }
+
+    // the moved list takes the objects, the cleared one lets them be linked again
+    intrusive_singly_linked_list<hooked_item, &hooked_item::first_hook> moved(std::move(first));
+    passed = passed && same_objects(moved, first_reference) && first.length() == 0 && !first.front();
+    moved.clear();
+    first_reference.clear();
+    for (hooked_item& object : objects)
+    {
+        moved.push_back(object);
+        first_reference.push_back(&object);
+    }
+    return passed && same_objects(moved, first_reference) && same_objects(second, second_reference);
+}
+
+// the skip list iterates over the values of the reference in its order
+template <typename List, typename Set>
+bool same_values(const List& list, const Set& reference)
+{
+    auto expected = reference.begin();
+    for (const auto& value : list)
+    {
+        if (expected == reference.end() || value != *expected)
+        {
+            return false;
+        }
+        ++expected;
+    }
+    return expected == reference.end() && list.size() == reference.size();
+}
+
+// random inserts, removes and lookups agree with std::set for both orders, lower_bound included
+template <typename Compare>
+bool check_skip_list_sequential()
+{
+    constexpr int range = 4000;
+    skip_list<int, Compare> list;
+    std::set<int, Compare> reference;
+    std::mt19937 random(16);
+
+    bool passed = true;
+    for (int step = 0; step < range * 5; ++step)
+    {
+        const int value = static_cast<int>(random() % range);
+        switch (random() % 3)
+        {
+        case 0:
+            passed = passed && list.insert(value) == reference.insert(value).second;
+            break;
+        case 1:
+            passed = passed && list.remove(value) == (reference.erase(value) == 1);
+            break;
+        default:
+            passed = passed && list.contains(value) == (reference.count(value) == 1);
+            break;
+        }
+    }
+    passed = passed && same_values(list, reference);
+
+    for (int value = -1; value <= range; ++value)
+    {
+        const auto expected = reference.lower_bound(value);
+        const auto found = list.lower_bound(value);
+        passed = passed &&
+                 (expected == reference.end() ? found == list.end() : found != list.end() && *found == *expected);
+    }
+
+    list.clear();
+    reference.clear();
+    passed = passed && same_values(list, reference) && list.insert(7) && list.contains(7) && list.size() == 1;
+    return passed;
+}
+
+// concurrent inserts of overlapping values succeed once per value and lose nothing
+bool check_skip_list_concurrent()
+{
+    constexpr int threads_count = 4;
+    constexpr int per_thread = 5000;
+
+    skip_list<int> list;
+    std::atomic<int> inserted(0);
+    std::atomic<bool> ordered(true);
+    std::atomic<int> writers_left(threads_count);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < threads_count; ++thread)
+    {
+        // every value is inserted by two threads
+        threads.emplace_back([&list, &inserted, &writers_left, thread] {
+            for (int idx = 0; idx < per_thread; ++idx)
+            {
+                const int value = (thread / 2) * per_thread + (thread % 2 == 0 ? idx : per_thread - 1 - idx);
+                inserted.fetch_add(list.insert(value) ? 1 : 0);
+            }
+            writers_left.fetch_sub(1);
+        });
+    }
+    // iteration during the inserts always sees a sorted sequence
+    threads.emplace_back([&list, &ordered, &writers_left] {
+        while (writers_left.load() > 0)
+        {
+            int previous = -1;
+            for (const int value : list)
+            {
+                ordered.store(ordered.load() && value > previous);
+                previous = value;
+            }
+        }
+    });
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::set<int> reference;
+    for (int value = 0; value < threads_count / 2 * per_thread; ++value)
+    {
+        reference.insert(value);
+    }
+    return ordered.load() && inserted.load() == static_cast<int>(reference.size()) && same_values(list, reference);
+}
+
+// the snapshot has the entries of the reference in order, numbered one after another up to the last sequence
+template <typename T>
+bool snapshot_matches(const append_only_log<T>& log, const std::list<T>& reference, const uint64_t last_sequence)
+{
+    const auto snapshot = log.take_snapshot();
+    bool passed = snapshot.length() == reference.size() && snapshot.last_sequence() == last_sequence &&
+                  snapshot.first_sequence() + reference.size() == last_sequence;
+    uint64_t sequence = snapshot.first_sequence();
+    auto expected = reference.begin();
+    for (auto entry = snapshot.begin(); entry != snapshot.end(); ++entry, ++expected)
+    {
+        passed = passed && expected != reference.end() && *entry == *expected && entry.sequence() == ++sequence;
+    }
+    return passed && expected == reference.end();
+}
+
+// appends and truncations of random sizes keep the same entries as std::list with the oldest ones dropped,
+// the sequence numbers go on from 1 through the truncations
+bool check_append_only_log_sequential()
+{
+    append_only_log<std::string> log;
+    std::list<std::string> reference;
+    std::mt19937 random(17);
+    uint64_t last_sequence = 0;
+    uint64_t dropped = 0;
+
+    bool passed = snapshot_matches(log, reference, 0) && log.truncate(5) == 0;
+    for (int step = 0; step < 2000; ++step)
+    {
+        if (random() % 4 == 0)
+        {
+            const size_t count = random() % 12;
+            const size_t expected = std::min(count, reference.size());
+            passed = passed && log.truncate(count) == expected;
+            for (size_t idx = 0; idx < expected; ++idx)
+            {
+                reference.pop_front();
+            }
+            dropped += expected;
+        }
+        else
+        {
+            std::string value = std::to_string(step);
+            reference.push_back(value);
+            const uint64_t sequence = step % 2 == 0 ? log.push_back(value) : log.push_back(std::move(value));
+            passed = passed && sequence == ++last_sequence;
+        }
+        passed = passed && log.length() == reference.size() && log.truncated() == dropped;
+        if (step % 50 == 0)
+        {
+            passed = passed && snapshot_matches(log, reference, last_sequence);
+        }
+    }
+    return passed && snapshot_matches(log, reference, last_sequence);
+}
+
+// producers, a truncating thread and readers at the same time: every push gets its own sequence number,
+// every snapshot is numbered without gaps and has the entries of each producer in order,
+// and nothing is lost: the pushed entries are either truncated or still in the log
+bool check_append_only_log_concurrent()
+{
+    constexpr int producers = 3;
+    constexpr int per_producer = 20000;
+
+    append_only_log<std::pair<int, int>> log;
+    std::vector<std::vector<uint64_t>> sequences(producers);
+    std::atomic<int> producers_left(producers);
+    std::atomic<bool> consistent(true);
+
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&log, &sequences, &producers_left, producer] {
+            for (int idx = 0; idx < per_producer; ++idx)
+            {
+                sequences[producer].push_back(log.push_back(std::make_pair(producer, idx)));
+            }
+            producers_left.fetch_sub(1);
+        });
+    }
+    threads.emplace_back([&log, &producers_left] {
+        while (producers_left.load() > 0)
+        {
+            log.truncate(100);
+            std::this_thread::yield();
+        }
+    });
+    threads.emplace_back([&log, &producers_left, &consistent] {
+        while (producers_left.load() > 0)
+        {
+            const auto snapshot = log.take_snapshot();
+            std::vector<int> last_index(producers, -1);
+            uint64_t sequence = snapshot.first_sequence();
+            size_t seen = 0;
+            for (auto entry = snapshot.begin(); entry != snapshot.end(); ++entry, ++seen)
+            {
+                const bool in_order = entry->second > last_index[entry->first] && entry.sequence() == ++sequence;
+                last_index[entry->first] = entry->second;
+                if (!in_order)
+                {
+                    consistent.store(false);
+                }
+            }
+            if (seen != snapshot.length() || sequence != snapshot.last_sequence())
+            {
+                consistent.store(false);
+            }
+        }
+    });
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (const auto& numbers : sequences)
+    {
+        all.insert(all.end(), numbers.begin(), numbers.end());
+    }
+    std::sort(all.begin(), all.end());
+    bool passed = consistent.load() && log.truncated() + log.length() == all.size();
+    for (size_t idx = 0; idx < all.size(); ++idx)
+    {
+        passed = passed && all[idx] == idx + 1;
+    }
+    return passed;
+}
+
+int main()
+{
+    report("Concurrent queue pops move-only values", check_queue_move_only());
+    report("Concurrent queue pops every value once under contention", check_queue_concurrent());
+    report("Indexed list handles strided keys", check_indexed_list_strided_keys());
+    report("Pooled allocator reuses the slots freed by another thread", check_pool_cross_thread_reuse());
+    report("Range constructor frees the built nodes on exception",
+           check_range_constructor_exception<heap_node_allocator>() &&
+               check_range_constructor_exception<pooled_node_allocator>());
+    report("Unrolled list matches std::list",
+           check_unrolled_list<int>([](const int value) { return value; }) &&
+               check_unrolled_list<std::string>([](const int value) { return std::to_string(value); }));
+    report("Sort, merge and splice match std::list",
+           check_sort_merge_splice<heap_node_allocator>() && check_sort_merge_splice<pooled_node_allocator>());
+    report("Remove, unique and partition match std::list",
+           check_remove_unique_partition<heap_node_allocator>() &&
+               check_remove_unique_partition<pooled_node_allocator>());
+    report("Binary write and read round-trip the lists",
+           check_binary_round_trip<heap_node_allocator>() && check_binary_round_trip<pooled_node_allocator>());
+    report("Intrusive lists match std::list of the objects", check_intrusive_list());
+    report("Skip list matches std::set",
+           check_skip_list_sequential<std::less<int>>() && check_skip_list_sequential<std::greater<int>>());
+    report("Skip list keeps every value of the concurrent inserts", check_skip_list_concurrent());
+    report("Append-only log matches std::list with the oldest entries dropped", check_append_only_log_sequential());
+    report("Append-only log numbers and keeps the concurrent entries", check_append_only_log_concurrent());
+    return failed_checks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
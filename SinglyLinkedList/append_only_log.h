@@ -0,0 +1,255 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "../Common/epoch_reclamation.h"
+
+// append-only singly linked list for event logs shared between threads
+// push_back is one atomic exchange of the tail plus the stores of the sequence number and the link,
+// producers never retry or lock (a producer only waits if the previous one is preempted right after its exchange)
+// readers take a snapshot (the current head, tail and length) and iterate it without locks or allocations,
+// entries appended after the snapshot are not visible in it
+// old entries are dropped in bulk with truncate, their nodes are reclaimed through the epoch domain,
+// so a snapshot keeps everything it can reach alive until it is destroyed
+template <typename T>
+class append_only_log
+{
+    struct node;
+
+public:
+    append_only_log() : truncated_(0)
+    {
+        node* sentinel = new node(0);
+        head_.store(sentinel, std::memory_order_relaxed);
+        tail_.store(sentinel, std::memory_order_relaxed);
+    }
+
+    append_only_log(const append_only_log& other) = delete;
+    append_only_log& operator=(const append_only_log& other) = delete;
+
+    // returns the sequence number of the entry, the first entry ever appended has number 1
+    uint64_t push_back(const T& value)
+    {
+        return append(new node(unknown_sequence, value));
+    }
+
+    uint64_t push_back(T&& value)
+    {
+        return append(new node(unknown_sequence, std::move(value)));
+    }
+
+    class iterator
+    {
+    public:
+        iterator(const node* current, const node* last) : node_(current), last_(last)
+        {
+        }
+
+        const T& operator*() const { return *node_->value; }
+        const T* operator->() const { return &*node_->value; }
+
+        // sequence number of the current entry
+        uint64_t sequence() const
+        {
+            return sequence_of(node_);
+        }
+
+        iterator& operator++()
+        {
+            node_ = node_ == last_ ? nullptr : wait_next(node_);
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const iterator& other) const { return node_ != other.node_; }
+
+    private:
+        const node* node_;
+        const node* last_;
+    };
+
+    // consistent view of the log at the moment of creation
+    // holds the epoch guard, so it should be short-lived: truncated nodes can't be reclaimed while it exists
+    class snapshot
+    {
+        friend class append_only_log;
+
+    public:
+        snapshot(const snapshot& other) = delete;
+        snapshot& operator=(const snapshot& other) = delete;
+
+        iterator begin() const
+        {
+            return first_ == last_ ? end() : iterator(wait_next(first_), last_);
+        }
+
+        iterator end() const
+        {
+            return iterator(nullptr, last_);
+        }
+
+        size_t length() const
+        {
+            return static_cast<size_t>(last_sequence_ - first_sequence_);
+        }
+
+        // sequence numbers of the entries are in (first_sequence, last_sequence]
+        uint64_t first_sequence() const
+        {
+            return first_sequence_;
+        }
+
+        uint64_t last_sequence() const
+        {
+            return last_sequence_;
+        }
+
+    private:
+        // the guard is taken before the nodes are loaded
+        explicit snapshot(const append_only_log& log)
+            : first_(log.head_.load(std::memory_order_acquire)), last_(log.tail_.load(std::memory_order_acquire)),
+              first_sequence_(sequence_of(first_)), last_sequence_(sequence_of(last_))
+        {
+        }
+
+        epoch_domain::guard guard_;
+        const node* first_;
+        const node* last_;
+        uint64_t first_sequence_;
+        uint64_t last_sequence_;
+    };
+
+    snapshot take_snapshot() const
+    {
+        return snapshot(*this);
+    }
+
+    // drops up to count oldest entries, returns the number of dropped entries
+    // can run concurrently with push_back and the readers, truncations are serialized with each other
+    size_t truncate(const size_t count)
+    {
+        std::lock_guard<std::mutex> lock(truncate_mutex_);
+
+        // only truncate frees the nodes, so the walk doesn't need the epoch guard
+        node* old_head = head_.load(std::memory_order_relaxed);
+        const node* tail = tail_.load(std::memory_order_acquire);
+        const uint64_t available = sequence_of(tail) - sequence_of(old_head);
+        const size_t to_drop = static_cast<size_t>(std::min<uint64_t>(count, available));
+
+        // the last dropped entry becomes the new sentinel, so the head never passes the tail
+        node* new_head = old_head;
+        for (size_t idx = 0; idx < to_drop; ++idx)
+        {
+            new_head = wait_next(new_head);
+        }
+        if (new_head == old_head)
+        {
+            return 0;
+        }
+        head_.store(new_head, std::memory_order_release);
+        truncated_.fetch_add(to_drop, std::memory_order_relaxed);
+
+        while (old_head != new_head)
+        {
+            node* next = old_head->next.load(std::memory_order_relaxed);
+            epoch_domain::global().retire(old_head);
+            old_head = next;
+        }
+        return to_drop;
+    }
+
+    // the number of entries between the head and the tail at the moment of the call
+    size_t length() const
+    {
+        epoch_domain::guard guard;
+        const node* head = head_.load(std::memory_order_acquire);
+        const node* tail = tail_.load(std::memory_order_acquire);
+        return static_cast<size_t>(sequence_of(tail) - sequence_of(head));
+    }
+
+    // the total number of entries dropped by truncate
+    uint64_t truncated() const
+    {
+        return truncated_.load(std::memory_order_relaxed);
+    }
+
+    ~append_only_log()
+    {
+        // no other threads can be left at destruction time
+        node* current = head_.load(std::memory_order_relaxed);
+        while (current)
+        {
+            node* to_delete = current;
+            current = current->next.load(std::memory_order_relaxed);
+            delete to_delete;
+        }
+    }
+
+private:
+    static constexpr uint64_t unknown_sequence = UINT64_MAX;
+
+    struct node
+    {
+        explicit node(const uint64_t node_sequence) : next(nullptr), sequence(node_sequence)
+        {
+        }
+
+        template <typename U>
+        node(const uint64_t node_sequence, U&& node_value)
+            : value(std::forward<U>(node_value)), next(nullptr), sequence(node_sequence)
+        {
+        }
+
+        // empty only in the initial sentinel
+        std::optional<T> value;
+        std::atomic<node*> next;
+        std::atomic<uint64_t> sequence;
+    };
+
+    uint64_t append(node* new_node)
+    {
+        node* prev = tail_.exchange(new_node, std::memory_order_acq_rel);
+
+        // prev's producer may still be between its own exchange and the sequence store
+        const uint64_t sequence = sequence_of(prev) + 1;
+        new_node->sequence.store(sequence, std::memory_order_release);
+        prev->next.store(new_node, std::memory_order_release);
+        return sequence;
+    }
+
+    // the tail is published before its sequence number and its link from the previous node,
+    // both are stored right after the exchange, so the waits are a few instructions long
+    static uint64_t sequence_of(const node* current)
+    {
+        uint64_t sequence = current->sequence.load(std::memory_order_acquire);
+        while (sequence == unknown_sequence)
+        {
+            std::this_thread::yield();
+            sequence = current->sequence.load(std::memory_order_acquire);
+        }
+        return sequence;
+    }
+
+    // must only be called for nodes before the tail
+    static node* wait_next(const node* current)
+    {
+        node* next = current->next.load(std::memory_order_acquire);
+        while (!next)
+        {
+            std::this_thread::yield();
+            next = current->next.load(std::memory_order_acquire);
+        }
+        return next;
+    }
+
+    // head and tail are changed by different threads, keep them on separate cache lines
+    alignas(64) std::atomic<node*> head_;
+    alignas(64) std::atomic<node*> tail_;
+    std::atomic<uint64_t> truncated_;
+    std::mutex truncate_mutex_;
+};
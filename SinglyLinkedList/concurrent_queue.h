@@ -0,0 +1,246 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+#include "../Common/epoch_reclamation.h"
+
+// lock-free multi-producer multi-consumer FIFO (Michael-Scott queue)
+// same head/tail singly linked design as singly_linked_list, but head always points to a dummy node:
+// the first value lives in head->next, so producers (tail) and consumers (head) never touch the same link
+// popped dummies are reclaimed through the epoch domain, since other consumers may still be reading them
+// the value of a node is touched only by the consumer that has moved head onto it, so it is moved out, not copied
+template <typename T>
+class concurrent_queue
+{
+public:
+    concurrent_queue()
+    {
+        node* dummy = new node();
+        head_.store(dummy, std::memory_order_relaxed);
+        tail_.store(dummy, std::memory_order_relaxed);
+    }
+
+    concurrent_queue(const concurrent_queue& other) = delete;
+    concurrent_queue& operator=(const concurrent_queue& other) = delete;
+
+    void push(const T& value)
+    {
+        node* new_node = new node(value);
+        link_chain(new_node, new_node);
+    }
+
+    void push(T&& value)
+    {
+        node* new_node = new node(std::move(value));
+        link_chain(new_node, new_node);
+    }
+
+    // values of the range are appended with one CAS and stay contiguous in the queue
+    template <typename InputIt>
+    void push_many(InputIt begin, InputIt end)
+    {
+        if (begin == end)
+        {
+            return;
+        }
+
+        // the chain is private until it is linked, so plain relaxed stores are enough
+        node* first = new node(*begin);
+        node* last = first;
+        for (++begin; begin != end; ++begin)
+        {
+            node* next = new node(*begin);
+            last->next.store(next, std::memory_order_relaxed);
+            last = next;
+        }
+        link_chain(first, last);
+    }
+
+    // returns the front value or nothing if the queue is empty
+    std::optional<T> try_pop()
+    {
+        std::optional<T> result;
+        node* to_retire = nullptr;
+        {
+            epoch_domain::guard guard;
+            while (true)
+            {
+                node* head = head_.load(std::memory_order_acquire);
+                node* tail = tail_.load(std::memory_order_acquire);
+                node* next = head->next.load(std::memory_order_acquire);
+                if (head != head_.load(std::memory_order_acquire))
+                {
+                    continue;
+                }
+
+                if (!next)
+                {
+                    return std::nullopt;
+                }
+
+                // tail is behind - help the producer to move it, head must never pass tail
+                if (head == tail)
+                {
+                    tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (head_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    // next becomes the new dummy, the other consumers never read its value
+                    // the guard is still needed: next may be popped and retired by them right away
+                    result.emplace(std::move(*next->value));
+                    next->value.reset();
+                    to_retire = head;
+                    break;
+                }
+            }
+        }
+
+        // never blocks, the old dummy is freed once no reader can hold it
+        epoch_domain::global().retire(to_retire);
+        return result;
+    }
+
+    // pops up to max_count values with one CAS and writes them to out in the FIFO order
+    // returns the number of popped values
+    template <typename OutputIt>
+    size_t pop_many(OutputIt out, const size_t max_count)
+    {
+        if (max_count == 0)
+        {
+            return 0;
+        }
+
+        size_t count = 0;
+        node* old_head = nullptr;
+        node* new_head = nullptr;
+        {
+            epoch_domain::guard guard;
+            while (true)
+            {
+                count = 0;
+                old_head = head_.load(std::memory_order_acquire);
+                new_head = old_head;
+                while (count < max_count)
+                {
+                    node* next = new_head->next.load(std::memory_order_acquire);
+                    if (!next)
+                    {
+                        break;
+                    }
+
+                    // tail only moves forward, so once it is ahead of new_head it stays ahead
+                    node* tail = tail_.load(std::memory_order_acquire);
+                    if (tail == new_head)
+                    {
+                        tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+                        continue;
+                    }
+
+                    new_head = next;
+                    count++;
+                }
+
+                if (new_head == old_head)
+                {
+                    return 0;
+                }
+                if (head_.compare_exchange_weak(old_head, new_head, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            // the values of old_head->next..new_head belong to this consumer now
+            for (node* current = old_head; current != new_head;)
+            {
+                current = current->next.load(std::memory_order_relaxed);
+                *out++ = std::move(*current->value);
+                current->value.reset();
+            }
+        }
+
+        // every node before the new dummy is unlinked now
+        while (old_head != new_head)
+        {
+            node* next = old_head->next.load(std::memory_order_relaxed);
+            epoch_domain::global().retire(old_head);
+            old_head = next;
+        }
+        return count;
+    }
+
+    // the answer may be outdated right away if other threads use the queue
+    bool empty() const
+    {
+        epoch_domain::guard guard;
+        return head_.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    ~concurrent_queue()
+    {
+        // no other threads can be left at destruction time
+        node* current = head_.load(std::memory_order_relaxed);
+        while (current)
+        {
+            node* to_delete = current;
+            current = current->next.load(std::memory_order_relaxed);
+            delete to_delete;
+        }
+    }
+
+private:
+    struct node
+    {
+        node() : next(nullptr)
+        {
+        }
+
+        template <typename U>
+        explicit node(U&& node_value) : next(nullptr), value(std::forward<U>(node_value))
+        {
+        }
+
+        std::atomic<node*> next;
+        // empty in the dummy
+        std::optional<T> value;
+    };
+
+    // appends already linked chain first..last to the end of the queue
+    void link_chain(node* first, node* last)
+    {
+        epoch_domain::guard guard;
+        while (true)
+        {
+            node* tail = tail_.load(std::memory_order_acquire);
+            node* next = tail->next.load(std::memory_order_acquire);
+            if (tail != tail_.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+
+            if (next)
+            {
+                // another producer linked its nodes but didn't move the tail yet - help it
+                tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+                continue;
+            }
+
+            node* expected = nullptr;
+            if (tail->next.compare_exchange_weak(expected, first, std::memory_order_release,
+                                                 std::memory_order_relaxed))
+            {
+                // failure is fine: somebody has already helped to move the tail
+                tail_.compare_exchange_strong(tail, last, std::memory_order_release, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // head and tail are changed by different threads, keep them on separate cache lines
+    alignas(64) std::atomic<node*> head_;
+    alignas(64) std::atomic<node*> tail_;
+};
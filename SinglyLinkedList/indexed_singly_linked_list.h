@@ -0,0 +1,374 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "node_allocators.h"
+#include "singly_linked_list.h"
+
+// singly linked list of unique values with a hash index over its nodes
+// the index maps every value to its node and the predecessor of the node (nullptr for the head),
+// so contains and remove are O(1) expected while the iteration keeps the insertion order
+// the index is an open addressing table with linear probing and backward shift deletion
+// the hashes are mixed before use: std::hash of an integer is the integer itself, so the strided keys
+// would all start probing from the same slots
+template <typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>,
+          typename Allocator = heap_node_allocator>
+class indexed_singly_linked_list
+{
+public:
+    using iterator = typename singly_linked_list<T, Allocator>::iterator;
+
+    explicit indexed_singly_linked_list(const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+        : head_(nullptr), tail_(nullptr), length_(0), hash_(hash), equal_(equal)
+    {
+    }
+
+    indexed_singly_linked_list(const indexed_singly_linked_list& other)
+        : head_(nullptr), tail_(nullptr), length_(0), hash_(other.hash_), equal_(other.equal_)
+    {
+        reserve(other.length_);
+        for (auto* current = other.head_; current; current = current->next())
+        {
+            push_back(current->get());
+        }
+    }
+
+    indexed_singly_linked_list(indexed_singly_linked_list&& other) noexcept
+        : head_(other.head_), tail_(other.tail_), length_(other.length_), slots_(std::move(other.slots_)),
+          hash_(std::move(other.hash_)), equal_(std::move(other.equal_))
+    {
+        other.head_ = other.tail_ = nullptr;
+        other.length_ = 0;
+        other.slots_.clear();
+    }
+
+    iterator begin() const { return iterator(head_); }
+    iterator end() const { return iterator(nullptr); }
+
+    // returns false if the value is already in the list
+    bool push_back(const T& value)
+    {
+        const size_t hash = hash_of(value);
+        const size_t slot = prepare_insert(value, hash);
+        if (slots_[slot].node)
+        {
+            return false;
+        }
+
+        auto* node = create_node(value, nullptr);
+        if (tail_)
+        {
+            tail_->set_next(node);
+        }
+        else
+        {
+            head_ = node;
+        }
+        slots_[slot] = {hash, node, tail_};
+        tail_ = node;
+        length_++;
+        return true;
+    }
+
+    // returns false if the value is already in the list
+    bool push_forward(const T& value)
+    {
+        const size_t hash = hash_of(value);
+        const size_t slot = prepare_insert(value, hash);
+        if (slots_[slot].node)
+        {
+            return false;
+        }
+
+        auto* node = create_node(value, head_);
+        slots_[slot] = {hash, node, nullptr};
+        if (head_)
+        {
+            // the old head gets a predecessor
+            slots_[find_slot(head_->get(), hash_of(head_->get()))].pred = node;
+        }
+        else
+        {
+            tail_ = node;
+        }
+        head_ = node;
+        length_++;
+        return true;
+    }
+
+    // returns false if there is no such value
+    bool remove(const T& value)
+    {
+        const size_t slot = find_slot(value, hash_of(value));
+        if (slot == npos)
+        {
+            return false;
+        }
+
+        auto* node = slots_[slot].node;
+        auto* pred = slots_[slot].pred;
+        auto* next = node->next();
+
+        // unlink the node, its successor takes over its predecessor
+        if (pred)
+        {
+            pred->set_next(next);
+        }
+        else
+        {
+            head_ = next;
+        }
+        if (next)
+        {
+            slots_[find_slot(next->get(), hash_of(next->get()))].pred = pred;
+        }
+        else
+        {
+            tail_ = pred;
+        }
+
+        // find_slot above doesn't move the slots, so the index of the node is still valid
+        erase_slot(slot);
+        destroy_node(node);
+        length_--;
+        return true;
+    }
+
+    bool contains(const T& value) const
+    {
+        return find_slot(value, hash_of(value)) != npos;
+    }
+
+    // prepares the index for count values, so inserting them doesn't rehash
+    void reserve(const size_t count)
+    {
+        size_t capacity = slots_.empty() ? min_capacity : slots_.size();
+        while (count * max_load_denominator > capacity * max_load_numerator)
+        {
+            capacity *= 2;
+        }
+        if (capacity != slots_.size())
+        {
+            rehash(capacity);
+        }
+    }
+
+    void clear()
+    {
+        auto* current = head_;
+        while (current)
+        {
+            auto* to_delete = current;
+            current = current->next();
+            destroy_node(to_delete);
+        }
+        for (auto& slot : slots_)
+        {
+            slot.node = nullptr;
+        }
+        head_ = tail_ = nullptr;
+        length_ = 0;
+    }
+
+    size_t length() const
+    {
+        return length_;
+    }
+
+    indexed_singly_linked_list& operator=(indexed_singly_linked_list&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            head_ = other.head_;
+            tail_ = other.tail_;
+            length_ = other.length_;
+            slots_ = std::move(other.slots_);
+            hash_ = std::move(other.hash_);
+            equal_ = std::move(other.equal_);
+            other.head_ = other.tail_ = nullptr;
+            other.length_ = 0;
+            other.slots_.clear();
+        }
+        return *this;
+    }
+
+    indexed_singly_linked_list& operator=(const indexed_singly_linked_list& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            hash_ = other.hash_;
+            equal_ = other.equal_;
+            reserve(other.length_);
+            for (auto* current = other.head_; current; current = current->next())
+            {
+                push_back(current->get());
+            }
+        }
+        return *this;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const indexed_singly_linked_list& list)
+    {
+        sll_node<T>* current = list.head_;
+        os << "[";
+
+        while (current)
+        {
+            os << current->get();
+
+            current = current->next();
+            if (current)
+            {
+                os << ", ";
+            }
+        }
+        os << "]";
+        return os;
+    }
+
+    ~indexed_singly_linked_list()
+    {
+        clear();
+    }
+
+private:
+    // node == nullptr marks an empty slot
+    struct index_slot
+    {
+        // mixed hash of the value (hash_of), the home slot is computed from it
+        size_t hash;
+        sll_node<T>* node;
+        sll_node<T>* pred;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t min_capacity = 16;
+    // the table grows when it is more than 3/4 full
+    static constexpr size_t max_load_numerator = 3;
+    static constexpr size_t max_load_denominator = 4;
+
+    size_t mask() const
+    {
+        return slots_.size() - 1;
+    }
+
+    // hash of the value passed through the murmur3 finalizer, so every bit of it affects the low bits
+    size_t hash_of(const T& value) const
+    {
+        uint64_t hash = static_cast<uint64_t>(hash_(value));
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return static_cast<size_t>(hash);
+    }
+
+    size_t home_slot(const size_t hash) const
+    {
+        return hash & mask();
+    }
+
+    size_t find_slot(const T& value, const size_t hash) const
+    {
+        if (slots_.empty())
+        {
+            return npos;
+        }
+
+        for (size_t idx = home_slot(hash);; idx = (idx + 1) & mask())
+        {
+            const index_slot& slot = slots_[idx];
+            if (!slot.node)
+            {
+                return npos;
+            }
+            // compare the stored hashes first to skip most of the value comparisons
+            if (slot.hash == hash && equal_(slot.node->get(), value))
+            {
+                return idx;
+            }
+        }
+    }
+
+    // returns the slot of the value if it's in the table, otherwise the empty slot to insert it to
+    size_t prepare_insert(const T& value, const size_t hash)
+    {
+        reserve(length_ + 1);
+        for (size_t idx = home_slot(hash);; idx = (idx + 1) & mask())
+        {
+            const index_slot& slot = slots_[idx];
+            if (!slot.node || (slot.hash == hash && equal_(slot.node->get(), value)))
+            {
+                return idx;
+            }
+        }
+    }
+
+    // closes the hole by moving back the following slots of the probe sequence, no tombstones are needed
+    void erase_slot(size_t hole)
+    {
+        for (size_t idx = (hole + 1) & mask(); slots_[idx].node; idx = (idx + 1) & mask())
+        {
+            // the slot can fill the hole only if its home position isn't between the hole and the slot
+            const size_t home = home_slot(slots_[idx].hash);
+            if (((idx - home) & mask()) >= ((idx - hole) & mask()))
+            {
+                slots_[hole] = slots_[idx];
+                hole = idx;
+            }
+        }
+        slots_[hole].node = nullptr;
+    }
+
+    void rehash(const size_t capacity)
+    {
+        std::vector<index_slot> old_slots(capacity, index_slot{0, nullptr, nullptr});
+        old_slots.swap(slots_);
+        for (const auto& slot : old_slots)
+        {
+            if (slot.node)
+            {
+                size_t idx = home_slot(slot.hash);
+                while (slots_[idx].node)
+                {
+                    idx = (idx + 1) & mask();
+                }
+                slots_[idx] = slot;
+            }
+        }
+    }
+
+    static sll_node<T>* create_node(const T& value, sll_node<T>* next)
+    {
+        void* memory = Allocator::template allocate<sll_node<T>>();
+        try
+        {
+            return new (memory) sll_node<T>(value, next);
+        }
+        catch (...)
+        {
+            Allocator::template deallocate<sll_node<T>>(static_cast<sll_node<T>*>(memory));
+            throw;
+        }
+    }
+
+    static void destroy_node(sll_node<T>* node)
+    {
+        node->~sll_node<T>();
+        Allocator::template deallocate<sll_node<T>>(node);
+    }
+
+    sll_node<T>* head_;
+    sll_node<T>* tail_;
+    size_t length_;
+    std::vector<index_slot> slots_;
+    Hash hash_;
+    KeyEqual equal_;
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+
+template <typename T>
+class sll_hook;
+
+template <typename T, sll_hook<T> T::*Member>
+class intrusive_singly_linked_list;
+
+// link embedded into the objects of intrusive lists, an object needs one hook per list it can be in at once
+template <typename T>
+class sll_hook
+{
+    template <typename U, sll_hook<U> U::*>
+    friend class intrusive_singly_linked_list;
+
+public:
+    sll_hook() : next_(nullptr)
+    {
+    }
+
+    // links belong to the list, not to the value, so copies of an object start unlinked
+    sll_hook(const sll_hook&) : next_(nullptr)
+    {
+    }
+
+    sll_hook& operator=(const sll_hook&)
+    {
+        return *this;
+    }
+
+private:
+    T* next_;
+};
+
+// singly linked list over the objects that embed sll_hook<T> as Member
+// the list never allocates and never owns the objects: they must stay alive and in place while linked,
+// and an object can't be in the same list (or two lists sharing the hook) twice
+template <typename T, sll_hook<T> T::*Member>
+class intrusive_singly_linked_list
+{
+public:
+    intrusive_singly_linked_list() : head_(nullptr), tail_(nullptr), length_(0)
+    {
+    }
+
+    intrusive_singly_linked_list(const intrusive_singly_linked_list& other) = delete;
+    intrusive_singly_linked_list& operator=(const intrusive_singly_linked_list& other) = delete;
+
+    intrusive_singly_linked_list(intrusive_singly_linked_list&& other) noexcept
+        : head_(other.head_), tail_(other.tail_), length_(other.length_)
+    {
+        other.head_ = other.tail_ = nullptr;
+        other.length_ = 0;
+    }
+
+    intrusive_singly_linked_list& operator=(intrusive_singly_linked_list&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            head_ = other.head_;
+            tail_ = other.tail_;
+            length_ = other.length_;
+            other.head_ = other.tail_ = nullptr;
+            other.length_ = 0;
+        }
+        return *this;
+    }
+
+    class iterator
+    {
+    public:
+        iterator(T* object) : object_(object)
+        {
+        }
+
+        T& operator*() { return *object_; }
+        T* operator->() { return object_; }
+
+        iterator& operator++()
+        {
+            object_ = next_of(object_);
+            return *this;
+        }
+
+        bool operator!=(const iterator& other) { return object_ != other.object_; }
+
+    private:
+        T* object_;
+    };
+
+    iterator begin() { return iterator(head_); }
+    iterator end() { return iterator(nullptr); }
+
+    T* front() const
+    {
+        return head_;
+    }
+
+    T* back() const
+    {
+        return tail_;
+    }
+
+    void push_back(T& object)
+    {
+        insert_after(tail_, object);
+    }
+
+    void push_forward(T& object)
+    {
+        insert_after(nullptr, object);
+    }
+
+    // links object after pred in O(1), nullptr pred inserts at the head
+    void insert_after(T* pred, T& object)
+    {
+        T*& link = pred ? hook_of(pred).next_ : head_;
+        hook_of(&object).next_ = link;
+        link = &object;
+        if (tail_ == pred)
+        {
+            tail_ = &object;
+        }
+        length_++;
+    }
+
+    // unlinks the object following pred in O(1), nullptr pred unlinks the head
+    // returns the unlinked object or nullptr if there is nothing after pred
+    T* remove_after(T* pred)
+    {
+        T*& link = pred ? hook_of(pred).next_ : head_;
+        T* removed = link;
+        if (!removed)
+        {
+            return nullptr;
+        }
+
+        link = hook_of(removed).next_;
+        hook_of(removed).next_ = nullptr;
+        if (tail_ == removed)
+        {
+            tail_ = pred;
+        }
+        length_--;
+        return removed;
+    }
+
+    T* pop_front()
+    {
+        return remove_after(nullptr);
+    }
+
+    // unlinks the object itself (not an equal one), linear since the predecessor has to be found
+    // returns false if the object isn't in the list
+    bool remove(T& object)
+    {
+        T* pred = nullptr;
+        for (T* current = head_; current; pred = current, current = next_of(current))
+        {
+            if (current == &object)
+            {
+                remove_after(pred);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(const T& object) const
+    {
+        for (T* current = head_; current; current = next_of(current))
+        {
+            if (current == &object)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // unlinks all the objects, the objects themselves are untouched
+    void clear()
+    {
+        T* current = head_;
+        while (current)
+        {
+            T* next = next_of(current);
+            hook_of(current).next_ = nullptr;
+            current = next;
+        }
+        head_ = tail_ = nullptr;
+        length_ = 0;
+    }
+
+    size_t length() const
+    {
+        return length_;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const intrusive_singly_linked_list& list)
+    {
+        T* current = list.head_;
+        os << "[";
+
+        while (current)
+        {
+            os << *current;
+
+            current = next_of(current);
+            if (current)
+            {
+                os << ", ";
+            }
+        }
+        os << "]";
+        return os;
+    }
+
+    ~intrusive_singly_linked_list()
+    {
+        clear();
+    }
+
+private:
+    static sll_hook<T>& hook_of(T* object)
+    {
+        return object->*Member;
+    }
+
+    static T* next_of(T* object)
+    {
+        return (object->*Member).next_;
+    }
+
+    T* head_;
+    T* tail_;
+    size_t length_;
+};
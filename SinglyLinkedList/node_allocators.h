@@ -0,0 +1,224 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+// allocation policies for the list nodes: memory only, nodes are constructed by the list
+// a policy provides static allocate<Node>(), deallocate<Node>(node) and reserve<Node>(count)
+
+// every node is a separate allocation of the global operator new
+struct heap_node_allocator
+{
+    template <typename Node>
+    static void* allocate()
+    {
+        return ::operator new(sizeof(Node));
+    }
+
+    template <typename Node>
+    static void deallocate(Node* node)
+    {
+        ::operator delete(node);
+    }
+
+    template <typename Node>
+    static void reserve(size_t)
+    {
+    }
+};
+
+// nodes are carved from big blocks and recycled through per-thread free lists, so the steady state
+// of push/remove does no malloc at all
+// the pool memory is never returned to the system: it is kept for reuse for the lifetime of the process
+// (nodes can be freed by another list or thread than the one that allocated them: a thread that frees more
+// than it allocates hands the surplus back to the shared list in batches, and the threads that run out
+// take the shared slots before carving a new block)
+struct pooled_node_allocator
+{
+    template <typename Node>
+    static void* allocate()
+    {
+        return node_pool<sizeof(Node), alignof(Node)>::allocate();
+    }
+
+    template <typename Node>
+    static void deallocate(Node* node)
+    {
+        node_pool<sizeof(Node), alignof(Node)>::deallocate(node);
+    }
+
+    // makes sure that the next count allocations of the thread are served from its free list without refills
+    template <typename Node>
+    static void reserve(const size_t count)
+    {
+        node_pool<sizeof(Node), alignof(Node)>::reserve(count);
+    }
+
+private:
+    template <size_t Size, size_t Align>
+    class node_pool
+    {
+        static_assert(Align <= alignof(std::max_align_t), "Over-aligned nodes are not supported by the pool");
+
+    public:
+        static void* allocate()
+        {
+            local_list& local = local_free_list();
+            if (!local.head)
+            {
+                refill(local, 1);
+            }
+            free_slot* slot = local.head;
+            local.head = slot->next;
+            local.count--;
+            if (local.reserved > 0)
+            {
+                local.reserved--;
+            }
+            return slot;
+        }
+
+        static void deallocate(void* ptr)
+        {
+            local_list& local = local_free_list();
+            local.head = new (ptr) free_slot{local.head};
+            local.count++;
+            // the slots reserved for the coming allocations are not given away
+            if (local.count > local.reserved + return_threshold)
+            {
+                return_surplus(local);
+            }
+        }
+
+        static void reserve(const size_t count)
+        {
+            local_list& local = local_free_list();
+            local.reserved = count;
+            if (local.count < count)
+            {
+                refill(local, count - local.count);
+            }
+        }
+
+    private:
+        struct free_slot
+        {
+            free_slot* next;
+        };
+
+        // slots have to fit the free list link and keep the alignment of the nodes
+        static constexpr size_t slot_size = (std::max(Size, sizeof(free_slot)) + Align - 1) / Align * Align;
+        static constexpr size_t min_block_slots = 64;
+        static constexpr size_t max_block_slots = 1 << 16;
+        // free slots a thread keeps beyond its reservation before it gives return_batch of them to the others
+        static constexpr size_t return_threshold = 1024;
+        static constexpr size_t return_batch = 512;
+
+        struct local_list
+        {
+            free_slot* head = nullptr;
+            size_t count = 0;
+            // slots promised by reserve to the coming allocations
+            size_t reserved = 0;
+            // blocks grow geometrically with the usage of the thread
+            size_t next_block_slots = min_block_slots;
+
+            // free slots of the finished thread go to the shared list
+            ~local_list()
+            {
+                if (head)
+                {
+                    push_shared(head, last_of(head), count);
+                }
+            }
+        };
+
+        struct shared_list
+        {
+            std::mutex mutex;
+            free_slot* head = nullptr;
+            size_t count = 0;
+        };
+
+        static local_list& local_free_list()
+        {
+            thread_local local_list list;
+            return list;
+        }
+
+        static shared_list& shared_free_list()
+        {
+            static shared_list list;
+            return list;
+        }
+
+        static free_slot* last_of(free_slot* chain)
+        {
+            while (chain->next)
+            {
+                chain = chain->next;
+            }
+            return chain;
+        }
+
+        // the chain is linked in before the lock is taken, so the lock is held only for the pointer swap
+        static void push_shared(free_slot* first, free_slot* last, const size_t count)
+        {
+            shared_list& shared = shared_free_list();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            last->next = shared.head;
+            shared.head = first;
+            shared.count += count;
+        }
+
+        // gives return_batch slots from the top of the local list to the shared list
+        static void return_surplus(local_list& local)
+        {
+            free_slot* first = local.head;
+            free_slot* last = first;
+            for (size_t idx = 1; idx < return_batch; ++idx)
+            {
+                last = last->next;
+            }
+            local.head = last->next;
+            local.count -= return_batch;
+            push_shared(first, last, return_batch);
+        }
+
+        // takes all the slots of the shared list (returned by the other threads or left by the finished ones),
+        // carves a new block only if there were not enough of them
+        static void refill(local_list& local, const size_t required)
+        {
+            free_slot* taken = nullptr;
+            size_t taken_count = 0;
+            {
+                shared_list& shared = shared_free_list();
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                std::swap(taken, shared.head);
+                std::swap(taken_count, shared.count);
+            }
+            if (taken)
+            {
+                last_of(taken)->next = local.head;
+                local.head = taken;
+                local.count += taken_count;
+                if (taken_count >= required)
+                {
+                    return;
+                }
+            }
+
+            const size_t block_slots = std::max(required - taken_count, local.next_block_slots);
+            local.next_block_slots = std::min(local.next_block_slots * 2, max_block_slots);
+
+            auto* block = static_cast<char*>(::operator new(block_slots * slot_size));
+            // chain the slots of the block in the address order, so the nodes are allocated sequentially
+            for (size_t idx = block_slots; idx > 0; --idx)
+            {
+                local.head = new (block + (idx - 1) * slot_size) free_slot{local.head};
+            }
+            local.count += block_slots;
+        }
+    };
+};
@@ -1,13 +1,33 @@
 #pragma once
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <new>
 #include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-template <typename T>
+#include "../Common/allocation_accounting.h"
+#include "node_allocators.h"
+#include "sll_stream_format.h"
+
+// Allocator is the node allocation policy (see node_allocators.h)
+template <typename T, typename Allocator = heap_node_allocator>
 class singly_linked_list;
 
+template <typename T, typename Hash, typename KeyEqual, typename Allocator>
+class indexed_singly_linked_list;
+
 template <typename T>
 class sll_node
 {
-    friend class singly_linked_list<T>;
+    template <typename, typename>
+    friend class singly_linked_list;
+    template <typename, typename, typename, typename>
+    friend class indexed_singly_linked_list;
 
 public:
     const T& get() const
@@ -25,6 +45,13 @@ private:
     {
     }
 
+    // constructs the value in place from the arguments of its constructor
+    template <typename... Args>
+    explicit sll_node(std::in_place_t, sll_node* next, Args&&... args)
+        : value_(std::forward<Args>(args)...), next_(next)
+    {
+    }
+
     void set_next(sll_node* next)
     {
         next_ = next;
@@ -34,7 +61,7 @@ private:
     sll_node* next_;
 };
 
-template <typename T>
+template <typename T, typename Allocator>
 class singly_linked_list
 {
 public:
@@ -55,10 +82,36 @@ public:
     singly_linked_list(singly_linked_list&& other) noexcept
         : head_(other.head_), tail_(other.tail_), length_(other.length_)
     {
+        transfer_nodes_from(other, length_);
         other.head_ = other.tail_ = nullptr;
         other.length_ = 0;
     }
 
+    // for forward ranges the allocator is asked to reserve the nodes up front: pooled_node_allocator takes them
+    // from one block, heap_node_allocator still allocates every node separately
+    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    singly_linked_list(InputIt begin, InputIt end) : head_(nullptr), tail_(nullptr), length_(0)
+    {
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+        {
+            Allocator::template reserve<sll_node<T>>(static_cast<size_t>(std::distance(begin, end)));
+        }
+        // the destructor doesn't run for a partly constructed list, so the built nodes are freed here
+        try
+        {
+            for (; begin != end; ++begin)
+            {
+                emplace_back(*begin);
+            }
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+    }
+
     class iterator
     {
     public:
@@ -84,21 +137,44 @@ public:
     iterator end() { return iterator(nullptr); }
 
     void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    void push_forward(const T& value)
+    {
+        emplace_front(value);
+    }
+
+    void push_forward(T&& value)
+    {
+        emplace_front(std::move(value));
+    }
+
+    // constructs the value in the new node at the end of the list
+    template <typename... Args>
+    void emplace_back(Args&&... args)
     {
         if (length_ == 0)
         {
-            push_forward(value);
+            emplace_front(std::forward<Args>(args)...);
             return;
         }
-        tail_->set_next(new sll_node<T>(value));
+        tail_->set_next(create_node(nullptr, std::forward<Args>(args)...));
         tail_ = tail_->next();
 
         length_++;
     }
 
-    void push_forward(const T& value)
+    template <typename... Args>
+    void emplace_front(Args&&... args)
     {
-        head_ = new sll_node<T>(value, head_);
+        head_ = create_node(head_, std::forward<Args>(args)...);
 
         if (length_ == 0)
         {
@@ -126,7 +202,7 @@ public:
                 }
                 current->set_next(to_delete->next());
                 length_--;
-                delete to_delete;
+                destroy_node(to_delete);
                 break;
             }
             current = current->next();
@@ -143,6 +219,128 @@ public:
         }
     }
 
+    // removes every value matching pred in one pass, returns the number of removed values
+    // the unlinked nodes are freed together after the pass
+    template <typename Predicate>
+    size_t remove_if(Predicate pred)
+    {
+        singly_linked_list removed;
+        return remove_if(pred, removed);
+    }
+
+    // same as above, but moves the unlinked nodes to the end of removed instead of freeing them
+    template <typename Predicate>
+    size_t remove_if(Predicate pred, singly_linked_list& removed)
+    {
+        node_chain removed_chain;
+        sll_node<T>** link = &head_;
+        sll_node<T>* kept_last = nullptr;
+        try
+        {
+            while (sll_node<T>* current = *link)
+            {
+                if (pred(current->get()))
+                {
+                    *link = current->next();
+                    removed_chain.append(current);
+                }
+                else
+                {
+                    kept_last = current;
+                    link = &current->next_;
+                }
+            }
+        }
+        catch (...)
+        {
+            // the node that pred failed on is still in the list, so the tail hasn't changed
+            move_chain_to(removed_chain, removed);
+            throw;
+        }
+
+        tail_ = kept_last;
+        return move_chain_to(removed_chain, removed);
+    }
+
+    size_t remove_all(const T& value)
+    {
+        return remove_if([&value](const T& current) { return current == value; });
+    }
+
+    // removes all but the first value of every group of consecutive equal values
+    // returns the number of removed values
+    template <typename BinaryPredicate = std::equal_to<T>>
+    size_t unique(BinaryPredicate equal = BinaryPredicate())
+    {
+        singly_linked_list removed;
+        node_chain removed_chain;
+        sll_node<T>* current = head_;
+        try
+        {
+            while (current && current->next())
+            {
+                sll_node<T>* next = current->next();
+                if (equal(current->get(), next->get()))
+                {
+                    current->set_next(next->next());
+                    removed_chain.append(next);
+                }
+                else
+                {
+                    current = next;
+                }
+            }
+        }
+        catch (...)
+        {
+            move_chain_to(removed_chain, removed);
+            throw;
+        }
+
+        if (current)
+        {
+            tail_ = current;
+        }
+        return move_chain_to(removed_chain, removed);
+    }
+
+    // stable partition: values matching pred go before the rest, keeping their relative order
+    // returns the number of values matching pred
+    template <typename Predicate>
+    size_t partition(Predicate pred)
+    {
+        node_chain matching;
+        node_chain rest;
+        size_t matching_count = 0;
+        sll_node<T>* current = head_;
+        try
+        {
+            while (current)
+            {
+                sll_node<T>* next = current->next();
+                if (pred(current->get()))
+                {
+                    matching.append(current);
+                    matching_count++;
+                }
+                else
+                {
+                    rest.append(current);
+                }
+                current = next;
+            }
+        }
+        catch (...)
+        {
+            // the nodes that were not visited yet keep their place after both chains
+            join_partitions(matching, rest, current);
+            throw;
+        }
+
+        join_partitions(matching, rest, nullptr);
+        return matching_count;
+    }
+
     bool contains(const T& value) const
     {
         auto* current = head_;
@@ -166,7 +364,7 @@ public:
         {
             auto* to_delete = current;
             current = current->next();
-            delete to_delete;
+            destroy_node(to_delete);
         }
         head_ = tail_ = nullptr;
         length_ = 0;
@@ -177,6 +375,92 @@ public:
         return length_;
     }
 
+    // stable bottom-up merge sort, relinks the nodes without any allocations
+    template <typename Compare = std::less<T>>
+    void sort(Compare comp = Compare())
+    {
+        if (length_ < 2)
+        {
+            return;
+        }
+
+        // merge neighbouring sorted runs of width nodes until one run covers the whole list
+        for (size_t width = 1; width < length_; width *= 2)
+        {
+            sll_node<T>* rest = head_;
+            sll_node<T>** link = &head_;
+            while (rest)
+            {
+                sll_node<T>* left = rest;
+                sll_node<T>* right = cut_after(left, width);
+                rest = cut_after(right, width);
+
+                sll_node<T>* last;
+                *link = merge_runs(left, right, comp, last);
+                link = &last->next_;
+                tail_ = last;
+            }
+        }
+    }
+
+    // moves all the nodes of other to the front of this list in O(1)
+    void splice_front(singly_linked_list& other)
+    {
+        if (this == &other || other.length_ == 0)
+        {
+            return;
+        }
+
+        if (length_ == 0)
+        {
+            tail_ = other.tail_;
+        }
+        other.tail_->set_next(head_);
+        head_ = other.head_;
+        take_length(other);
+    }
+
+    // moves all the nodes of other to the back of this list in O(1)
+    void splice_back(singly_linked_list& other)
+    {
+        if (this == &other || other.length_ == 0)
+        {
+            return;
+        }
+
+        if (length_ == 0)
+        {
+            head_ = other.head_;
+        }
+        else
+        {
+            tail_->set_next(other.head_);
+        }
+        tail_ = other.tail_;
+        take_length(other);
+    }
+
+    // merges the nodes of sorted other into this sorted list in linear time, other becomes empty
+    // stable: of equal values the ones of this list go first
+    template <typename Compare = std::less<T>>
+    void merge(singly_linked_list& other, Compare comp = Compare())
+    {
+        if (this == &other || other.length_ == 0)
+        {
+            return;
+        }
+        if (length_ == 0)
+        {
+            splice_back(other);
+            return;
+        }
+
+        sll_node<T>* last;
+        head_ = merge_runs(head_, other.head_, comp, last);
+        tail_ = last;
+        take_length(other);
+    }
+
     singly_linked_list& operator=(singly_linked_list&& other) noexcept
     {
         if (this != &other)
@@ -185,6 +469,7 @@ public:
             head_ = other.head_;
             tail_ = other.tail_;
             length_ = other.length_;
+            transfer_nodes_from(other, length_);
             other.head_ = other.tail_ = nullptr;
             other.length_ = 0;
         }
@@ -195,19 +480,80 @@ public:
     {
         if (this != &other)
         {
-            clear();
-            
-            auto* current = other.head_;
-            while (current)
+            // reuse the existing nodes, assigning the values of other to them
+            sll_node<T>* last_assigned = nullptr;
+            auto* current = head_;
+            auto* source = other.head_;
+            while (current && source)
             {
-                this->push_back(current->get());
+                current->value_ = source->get();
+                last_assigned = current;
                 current = current->next();
+                source = source->next();
+            }
+
+            // this list is longer - free the rest of the nodes
+            if (current)
+            {
+                if (last_assigned)
+                {
+                    last_assigned->set_next(nullptr);
+                }
+                else
+                {
+                    head_ = nullptr;
+                }
+                tail_ = last_assigned;
+                while (current)
+                {
+                    auto* to_delete = current;
+                    current = current->next();
+                    destroy_node(to_delete);
+                }
+                length_ = other.length_;
+            }
+
+            // other list is longer - allocate nodes only for the rest
+            while (source)
+            {
+                this->push_back(source->get());
+                source = source->next();
             }
         }
         return *this;
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const singly_linked_list<T>& list)
+    // BINARY I/O
+    // the values are copied in big blocks without formatting, the layout is described in sll_stream_format.h
+
+    void write(std::ostream& os) const
+    {
+        write_blocks([&os](const char* data, const size_t size) { os.write(data, static_cast<std::streamsize>(size)); });
+        if (!os)
+        {
+            throw std::runtime_error("Couldn't write the list: stream write failed");
+        }
+    }
+
+    void write(const int fd) const
+    {
+        write_blocks([fd](const char* data, const size_t size) { sll_fd_io::write_all(fd, data, size); });
+    }
+
+    static singly_linked_list read(std::istream& is)
+    {
+        return read_blocks([&is](char* data, const size_t size)
+        {
+            return static_cast<bool>(is.read(data, static_cast<std::streamsize>(size)));
+        });
+    }
+
+    static singly_linked_list read(const int fd)
+    {
+        return read_blocks([fd](char* data, const size_t size) { return sll_fd_io::read_all(fd, data, size); });
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const singly_linked_list& list)
     {
         sll_node<T>* current = list.head_;
         os << "[";
@@ -226,6 +572,17 @@ public:
         return os;
     }
 
+    // memory of the nodes of this list (see allocation_accounting.h), empty when accounting is compiled out
+    // nodes moved in from other lists (splice, merge, move) are counted in the live bytes of this list
+    allocation_stats allocations() const
+    {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        return allocations_.stats();
+#else
+        return allocation_stats();
+#endif
+    }
+
     ~singly_linked_list()
     {
         auto* current = head_;
@@ -234,12 +591,246 @@ public:
         {
             auto* to_delete = current;
             current = current->next();
-            delete to_delete;
+            destroy_node(to_delete);
         }
     }
 
 private:
+    // with the pooled allocator the accounted bytes are the nodes in use, not the blocks of the pool
+    template <typename... Args>
+    sll_node<T>* create_node(sll_node<T>* next, Args&&... args)
+    {
+        void* memory = Allocator::template allocate<sll_node<T>>();
+        sll_node<T>* node;
+        try
+        {
+            node = new (memory) sll_node<T>(std::in_place, next, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Allocator::template deallocate<sll_node<T>>(static_cast<sll_node<T>*>(memory));
+            throw;
+        }
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.record_allocation(sizeof(sll_node<T>));
+#endif
+        return node;
+    }
+
+    void destroy_node(sll_node<T>* node)
+    {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.record_deallocation(sizeof(sll_node<T>));
+#endif
+        node->~sll_node<T>();
+        Allocator::template deallocate<sll_node<T>>(node);
+    }
+
+    // count nodes of other were relinked to this list
+    void transfer_nodes_from(singly_linked_list& other, const size_t count)
+    {
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+        allocations_.transfer_from(other.allocations_, count * sizeof(sll_node<T>));
+#else
+        (void)other;
+        (void)count;
+#endif
+    }
+
+    static constexpr size_t io_block_size = 1 << 16;
+
+    // passes the header and the values to sink in blocks of io_block_size values
+    template <typename Sink>
+    void write_blocks(Sink sink) const
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Binary serialization requires trivially copyable values");
+
+        const sll_stream_header header = sll_stream_header::make(sizeof(T), length_);
+        sink(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<T> block;
+        block.reserve(std::min(length_, io_block_size));
+        for (auto* current = head_; current; current = current->next())
+        {
+            block.push_back(current->get());
+            if (block.size() == io_block_size)
+            {
+                sink(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+                block.clear();
+            }
+        }
+        if (!block.empty())
+        {
+            sink(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+        }
+    }
+
+    // source fills the buffer completely or returns false
+    template <typename Source>
+    static singly_linked_list read_blocks(Source source)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Binary serialization requires trivially copyable values");
+
+        sll_stream_header header{};
+        if (!source(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            throw std::runtime_error("Couldn't read the list: stream is truncated");
+        }
+        header.validate(sizeof(T));
+
+        singly_linked_list list;
+        // the count isn't trusted for the allocations: memory grows only with the values actually read
+        std::vector<T> block;
+        for (uint64_t remaining = header.value_count; remaining > 0;)
+        {
+            const size_t block_count = static_cast<size_t>(std::min<uint64_t>(remaining, io_block_size));
+            block.resize(block_count);
+            if (!source(reinterpret_cast<char*>(block.data()), block_count * sizeof(T)))
+            {
+                throw std::runtime_error("Couldn't read the list: stream is truncated");
+            }
+
+            Allocator::template reserve<sll_node<T>>(block_count);
+            for (const T& value : block)
+            {
+                list.emplace_back(value);
+            }
+            remaining -= block_count;
+        }
+        return list;
+    }
+
+    // null-terminated sequence of the nodes that were unlinked or regrouped during one pass
+    struct node_chain
+    {
+        sll_node<T>* head = nullptr;
+        sll_node<T>* last = nullptr;
+        size_t length = 0;
+
+        void append(sll_node<T>* node)
+        {
+            if (last)
+            {
+                last->set_next(node);
+            }
+            else
+            {
+                head = node;
+            }
+            last = node;
+            length++;
+        }
+    };
+
+    // moves the nodes unlinked from this list to the end of target, returns their number
+    size_t move_chain_to(node_chain& chain, singly_linked_list& target)
+    {
+        if (chain.length == 0)
+        {
+            return 0;
+        }
+
+        chain.last->set_next(nullptr);
+        length_ -= chain.length;
+        if (target.length_ == 0)
+        {
+            target.head_ = chain.head;
+        }
+        else
+        {
+            target.tail_->set_next(chain.head);
+        }
+        target.tail_ = chain.last;
+        target.length_ += chain.length;
+        target.transfer_nodes_from(*this, chain.length);
+        return chain.length;
+    }
+
+    // relinks the list as matching + rest + unvisited nodes
+    void join_partitions(node_chain& matching, node_chain& rest, sll_node<T>* unvisited)
+    {
+        if (matching.length == 0 && rest.length == 0)
+        {
+            return;
+        }
+
+        if (rest.length > 0)
+        {
+            rest.last->set_next(unvisited);
+        }
+        if (matching.length > 0)
+        {
+            matching.last->set_next(rest.length > 0 ? rest.head : unvisited);
+        }
+        head_ = matching.length > 0 ? matching.head : rest.head;
+        if (!unvisited)
+        {
+            tail_ = rest.length > 0 ? rest.last : matching.last;
+        }
+    }
+
+    // adds the length of other, which nodes were relinked to this list, and leaves other empty
+    void take_length(singly_linked_list& other)
+    {
+        transfer_nodes_from(other, other.length_);
+        length_ += other.length_;
+        other.head_ = other.tail_ = nullptr;
+        other.length_ = 0;
+    }
+
+    // detaches the first count nodes of the chain starting from node, returns the rest of the chain
+    static sll_node<T>* cut_after(sll_node<T>* node, size_t count)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+        while (--count > 0 && node->next())
+        {
+            node = node->next();
+        }
+        sll_node<T>* rest = node->next();
+        node->set_next(nullptr);
+        return rest;
+    }
+
+    // merges two sorted null-terminated chains, last receives the tail of the result
+    template <typename Compare>
+    static sll_node<T>* merge_runs(sll_node<T>* left, sll_node<T>* right, Compare& comp, sll_node<T>*& last)
+    {
+        sll_node<T>* head = nullptr;
+        sll_node<T>** link = &head;
+        last = nullptr;
+        while (left && right)
+        {
+            // take the right value only if it's strictly less to keep the sort stable
+            if (comp(right->get(), left->get()))
+            {
+                *link = right;
+                right = right->next();
+            }
+            else
+            {
+                *link = left;
+                left = left->next();
+            }
+            last = *link;
+            link = &last->next_;
+        }
+        *link = left ? left : right;
+
+        // only the remainder has to be walked to find the tail
+        for (sll_node<T>* current = *link; current; current = current->next())
+        {
+            last = current;
+        }
+        return head;
+    }
+
     sll_node<T>* head_;
     sll_node<T>* tail_;
     size_t length_;
+#ifdef ENABLE_ALLOCATION_ACCOUNTING
+    allocation_account allocations_;
+#endif
 };
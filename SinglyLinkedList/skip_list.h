@@ -0,0 +1,298 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <random>
+#include <thread>
+#include <utility>
+
+// ordered set of unique values: a sorted singly linked list where every node has a tower of forward links,
+// the link of level i skips about 2^i nodes, so search, insert and remove are O(log n) expected
+// the tower is allocated inline with the node, one allocation per value
+// insert, contains, lower_bound and iteration are lock-free and can run concurrently with each other;
+// remove and clear need exclusive access (no other operation running), so nodes are never freed under readers
+template <typename T, typename Compare = std::less<T>>
+class skip_list
+{
+    struct node;
+
+public:
+    static constexpr size_t max_height = 32;
+
+    explicit skip_list(const Compare& comparator = Compare()) : size_(0), comparator_(comparator)
+    {
+        for (auto& link : head_)
+        {
+            link.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    skip_list(const skip_list& other) = delete;
+    skip_list& operator=(const skip_list& other) = delete;
+
+    class iterator
+    {
+    public:
+        iterator(const node* current) : node_(current)
+        {
+        }
+
+        const T& operator*() const { return node_->value; }
+        const T* operator->() const { return &node_->value; }
+
+        iterator& operator++()
+        {
+            node_ = node_->next(0).load(std::memory_order_acquire);
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const iterator& other) const { return node_ != other.node_; }
+
+    private:
+        const node* node_;
+    };
+
+    iterator begin() const { return iterator(head_[0].load(std::memory_order_acquire)); }
+    iterator end() const { return iterator(nullptr); }
+
+    // returns false if the value is already in the set
+    bool insert(const T& value)
+    {
+        node* preds[max_height];
+        node* succs[max_height];
+        if (find_position(value, preds, succs))
+        {
+            return false;
+        }
+
+        const size_t height = random_height();
+        node* new_node = create_node(value, height);
+
+        // the node becomes a member of the set once it's linked at the bottom level
+        while (true)
+        {
+            for (size_t level = 0; level < height; ++level)
+            {
+                new_node->next(level).store(succs[level], std::memory_order_relaxed);
+            }
+            if (links_of(preds[0])[0].compare_exchange_strong(succs[0], new_node, std::memory_order_release,
+                                                              std::memory_order_relaxed))
+            {
+                break;
+            }
+
+            // another thread changed the neighbourhood, possibly inserting the same value
+            if (find_position(value, preds, succs))
+            {
+                destroy_node(new_node);
+                return false;
+            }
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+
+        // upper levels are only shortcuts, they are linked one by one
+        for (size_t level = 1; level < height; ++level)
+        {
+            while (true)
+            {
+                new_node->next(level).store(succs[level], std::memory_order_relaxed);
+                if (links_of(preds[level])[level].compare_exchange_strong(
+                        succs[level], new_node, std::memory_order_release, std::memory_order_relaxed))
+                {
+                    break;
+                }
+                find_position(value, preds, succs);
+            }
+        }
+        return true;
+    }
+
+    bool contains(const T& value) const
+    {
+        const node* found = lower_bound_node(value);
+        return found && !comparator_(value, found->value);
+    }
+
+    // iterator to the first value that is not less than value
+    iterator lower_bound(const T& value) const
+    {
+        return iterator(lower_bound_node(value));
+    }
+
+    // requires exclusive access, returns false if there is no such value
+    bool remove(const T& value)
+    {
+        node* preds[max_height];
+        node* succs[max_height];
+        if (!find_position(value, preds, succs))
+        {
+            return false;
+        }
+
+        node* target = succs[0];
+        for (size_t level = 0; level < target->height; ++level)
+        {
+            links_of(preds[level])[level].store(target->next(level).load(std::memory_order_relaxed),
+                                                std::memory_order_relaxed);
+        }
+        destroy_node(target);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    // requires exclusive access
+    void clear()
+    {
+        node* current = head_[0].load(std::memory_order_relaxed);
+        while (current)
+        {
+            node* to_delete = current;
+            current = current->next(0).load(std::memory_order_relaxed);
+            destroy_node(to_delete);
+        }
+        for (auto& link : head_)
+        {
+            link.store(nullptr, std::memory_order_relaxed);
+        }
+        size_.store(0, std::memory_order_relaxed);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const skip_list& list)
+    {
+        os << "[";
+        for (auto it = list.begin(); it != list.end();)
+        {
+            os << *it;
+            if (++it != list.end())
+            {
+                os << ", ";
+            }
+        }
+        os << "]";
+        return os;
+    }
+
+    ~skip_list()
+    {
+        clear();
+    }
+
+private:
+    // the value is followed by height atomic links in the same allocation
+    struct node
+    {
+        T value;
+        size_t height;
+
+        std::atomic<node*>* tower() const
+        {
+            return reinterpret_cast<std::atomic<node*>*>(
+                reinterpret_cast<char*>(const_cast<node*>(this)) + tower_offset());
+        }
+
+        std::atomic<node*>& next(const size_t level) const
+        {
+            return tower()[level];
+        }
+
+        static size_t tower_offset()
+        {
+            return (sizeof(node) + alignof(std::atomic<node*>) - 1) / alignof(std::atomic<node*>) *
+                   alignof(std::atomic<node*>);
+        }
+    };
+
+    static node* create_node(const T& value, const size_t height)
+    {
+        void* memory = ::operator new(node::tower_offset() + height * sizeof(std::atomic<node*>));
+        node* new_node;
+        try
+        {
+            new_node = new (memory) node{value, height};
+        }
+        catch (...)
+        {
+            ::operator delete(memory);
+            throw;
+        }
+        for (size_t level = 0; level < height; ++level)
+        {
+            new (&new_node->next(level)) std::atomic<node*>(nullptr);
+        }
+        return new_node;
+    }
+
+    static void destroy_node(node* to_delete)
+    {
+        to_delete->~node();
+        ::operator delete(to_delete);
+    }
+
+    // links of the node or the head links for nullptr
+    std::atomic<node*>* links_of(node* current)
+    {
+        return current ? current->tower() : head_;
+    }
+
+    // fills the last node less than value (nullptr - head) and its successor on every level
+    // returns true if succs[0] holds value
+    bool find_position(const T& value, node** preds, node** succs)
+    {
+        node* pred = nullptr;
+        for (size_t level = max_height; level-- > 0;)
+        {
+            node* current = links_of(pred)[level].load(std::memory_order_acquire);
+            while (current && comparator_(current->value, value))
+            {
+                pred = current;
+                current = current->next(level).load(std::memory_order_acquire);
+            }
+            preds[level] = pred;
+            succs[level] = current;
+        }
+        return succs[0] && !comparator_(value, succs[0]->value);
+    }
+
+    const node* lower_bound_node(const T& value) const
+    {
+        const node* pred = nullptr;
+        const node* current = nullptr;
+        for (size_t level = max_height; level-- > 0;)
+        {
+            current = (pred ? pred->next(level) : head_[level]).load(std::memory_order_acquire);
+            while (current && comparator_(current->value, value))
+            {
+                pred = current;
+                current = current->next(level).load(std::memory_order_acquire);
+            }
+        }
+        return current;
+    }
+
+    // geometric distribution with p = 1/2, every thread has its own generator
+    static size_t random_height()
+    {
+        thread_local std::mt19937_64 generator(std::random_device{}() ^
+                                               std::hash<std::thread::id>()(std::this_thread::get_id()));
+        uint64_t bits = generator();
+        size_t height = 1;
+        while ((bits & 1) && height < max_height)
+        {
+            bits >>= 1;
+            height++;
+        }
+        return height;
+    }
+
+    std::atomic<node*> head_[max_height];
+    std::atomic<size_t> size_;
+    Compare comparator_;
+};
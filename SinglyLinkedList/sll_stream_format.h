@@ -0,0 +1,112 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// binary stream of a list: the header followed by value_count values in the list order
+// values are stored in the native byte order, so the streams are meant to be read on the same platform
+struct sll_stream_header
+{
+    char magic[8];
+    uint32_t format_version;
+    uint32_t value_size;
+    uint64_t value_count;
+
+    static constexpr uint32_t current_version = 1;
+
+    static sll_stream_header make(const uint32_t value_size, const uint64_t value_count)
+    {
+        sll_stream_header header{};
+        std::memcpy(header.magic, expected_magic(), sizeof(header.magic));
+        header.format_version = current_version;
+        header.value_size = value_size;
+        header.value_count = value_count;
+        return header;
+    }
+
+    void validate(const uint32_t expected_value_size) const
+    {
+        if (std::memcmp(magic, expected_magic(), sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("Couldn't read the list: not a list stream");
+        }
+        if (format_version != current_version)
+        {
+            throw std::runtime_error("Couldn't read the list: unsupported format version");
+        }
+        if (value_size != expected_value_size)
+        {
+            throw std::runtime_error("Couldn't read the list: value size mismatch");
+        }
+    }
+
+    static const char* expected_magic()
+    {
+        return "SLLDATA";
+    }
+};
+
+// raw descriptor I/O that retries partial transfers and interrupted calls
+namespace sll_fd_io
+{
+    inline void write_all(const int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            const int chunk = size > (1u << 30) ? (1 << 30) : static_cast<int>(size);
+            const int written = _write(fd, data, chunk);
+#else
+            const ssize_t written = ::write(fd, data, size);
+#endif
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Couldn't write the list: " + std::string(std::strerror(errno)));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    // returns false if the descriptor ended before size bytes were read
+    inline bool read_all(const int fd, char* data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            const int chunk = size > (1u << 30) ? (1 << 30) : static_cast<int>(size);
+            const int count = _read(fd, data, chunk);
+#else
+            const ssize_t count = ::read(fd, data, size);
+#endif
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Couldn't read the list: " + std::string(std::strerror(errno)));
+            }
+            if (count == 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+}
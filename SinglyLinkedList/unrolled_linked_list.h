@@ -0,0 +1,337 @@
+#pragma once
+#include <algorithm>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UNROLLED_LIST_USE_SSE2
+#endif
+
+// singly linked list that keeps a small array of elements in every node instead of one element
+// scans touch one node per chunk_capacity elements and compare the elements of a chunk with SIMD,
+// while push_back, push_forward and remove keep the list semantics
+template <typename T>
+class unrolled_linked_list
+{
+public:
+    // elements per node: the node takes about two cache lines
+    static constexpr size_t chunk_capacity =
+        std::max<size_t>(4, (128 - sizeof(void*) - sizeof(size_t)) / sizeof(T));
+
+    unrolled_linked_list() : head_(nullptr), tail_(nullptr), length_(0)
+    {
+    }
+
+    unrolled_linked_list(const unrolled_linked_list& other) : head_(nullptr), tail_(nullptr), length_(0)
+    {
+        for (const chunk* current = other.head_; current; current = current->next)
+        {
+            for (size_t idx = 0; idx < current->count; ++idx)
+            {
+                push_back(current->data()[idx]);
+            }
+        }
+    }
+
+    unrolled_linked_list(unrolled_linked_list&& other) noexcept
+        : head_(other.head_), tail_(other.tail_), length_(other.length_)
+    {
+        other.head_ = other.tail_ = nullptr;
+        other.length_ = 0;
+    }
+
+    class iterator
+    {
+    public:
+        iterator(const typename unrolled_linked_list::chunk* node, const size_t index) : node_(node), index_(index)
+        {
+        }
+
+        const T& operator*() { return node_->data()[index_]; }
+
+        iterator& operator++()
+        {
+            if (++index_ == node_->count)
+            {
+                node_ = node_->next;
+                index_ = 0;
+            }
+            return *this;
+        }
+
+        bool operator!=(const iterator& other) { return node_ != other.node_ || index_ != other.index_; }
+
+    private:
+        const typename unrolled_linked_list::chunk* node_;
+        size_t index_;
+    };
+
+    iterator begin() { return iterator(head_, 0); }
+    iterator end() { return iterator(nullptr, 0); }
+
+    void push_back(const T& value)
+    {
+        if (!tail_ || tail_->count == chunk_capacity)
+        {
+            chunk* node = new chunk();
+            if (tail_)
+            {
+                tail_->next = node;
+            }
+            else
+            {
+                head_ = node;
+            }
+            tail_ = node;
+        }
+        new (tail_->data() + tail_->count) T(value);
+        tail_->count++;
+        length_++;
+    }
+
+    void push_forward(const T& value)
+    {
+        if (!head_ || head_->count == chunk_capacity)
+        {
+            head_ = new chunk(head_);
+            if (!tail_)
+            {
+                tail_ = head_;
+            }
+        }
+        insert_front(head_, value);
+        length_++;
+    }
+
+    // removes the first occurrence of value
+    void remove(const T& value)
+    {
+        chunk* previous = nullptr;
+        for (chunk* current = head_; current; previous = current, current = current->next)
+        {
+            T* data = current->data();
+            for (size_t idx = 0; idx < current->count; ++idx)
+            {
+                if (data[idx] == value)
+                {
+                    erase_at(current, idx);
+                    length_--;
+                    rebalance_after_erase(previous, current);
+                    return;
+                }
+            }
+        }
+    }
+
+    bool contains(const T& value) const
+    {
+        for (const chunk* current = head_; current; current = current->next)
+        {
+            if (chunk_contains(current->data(), current->count, value))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        chunk* current = head_;
+        while (current)
+        {
+            chunk* to_delete = current;
+            current = current->next;
+            delete to_delete;
+        }
+        head_ = tail_ = nullptr;
+        length_ = 0;
+    }
+
+    size_t length() const
+    {
+        return length_;
+    }
+
+    unrolled_linked_list& operator=(unrolled_linked_list&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            head_ = other.head_;
+            tail_ = other.tail_;
+            length_ = other.length_;
+            other.head_ = other.tail_ = nullptr;
+            other.length_ = 0;
+        }
+        return *this;
+    }
+
+    unrolled_linked_list& operator=(const unrolled_linked_list& other)
+    {
+        if (this != &other)
+        {
+            unrolled_linked_list copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const unrolled_linked_list<T>& list)
+    {
+        os << "[";
+        bool first = true;
+        for (const chunk* current = list.head_; current; current = current->next)
+        {
+            for (size_t idx = 0; idx < current->count; ++idx)
+            {
+                if (!first)
+                {
+                    os << ", ";
+                }
+                os << current->data()[idx];
+                first = false;
+            }
+        }
+        os << "]";
+        return os;
+    }
+
+    ~unrolled_linked_list()
+    {
+        clear();
+    }
+
+private:
+    // node of the list: elements are constructed in the raw storage, only the first count are alive
+    struct chunk
+    {
+        explicit chunk(chunk* next_chunk = nullptr) : next(next_chunk), count(0)
+        {
+        }
+
+        chunk(const chunk& other) = delete;
+        chunk& operator=(const chunk& other) = delete;
+
+        ~chunk()
+        {
+            for (size_t idx = 0; idx < count; ++idx)
+            {
+                data()[idx].~T();
+            }
+        }
+
+        T* data() { return std::launder(reinterpret_cast<T*>(storage)); }
+        const T* data() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+
+        chunk* next;
+        size_t count;
+        alignas(T) unsigned char storage[sizeof(T) * chunk_capacity];
+    };
+
+    // shifts the elements of a non-full chunk to the right and puts value first
+    static void insert_front(chunk* node, const T& value)
+    {
+        T* data = node->data();
+        if (node->count == 0)
+        {
+            new (data) T(value);
+        }
+        else
+        {
+            new (data + node->count) T(std::move(data[node->count - 1]));
+            std::move_backward(data, data + node->count - 1, data + node->count);
+            data[0] = value;
+        }
+        node->count++;
+    }
+
+    static void erase_at(chunk* node, const size_t index)
+    {
+        T* data = node->data();
+        std::move(data + index + 1, data + node->count, data + index);
+        data[node->count - 1].~T();
+        node->count--;
+    }
+
+    // drops the emptied chunk or merges the half-empty one with the next, so chunks stay reasonably full
+    void rebalance_after_erase(chunk* previous, chunk* node)
+    {
+        if (node->count == 0)
+        {
+            (previous ? previous->next : head_) = node->next;
+            if (tail_ == node)
+            {
+                tail_ = previous;
+            }
+            delete node;
+            return;
+        }
+
+        chunk* next = node->next;
+        if (next && node->count < chunk_capacity / 2 && node->count + next->count <= chunk_capacity)
+        {
+            T* data = node->data();
+            for (size_t idx = 0; idx < next->count; ++idx)
+            {
+                new (data + node->count + idx) T(std::move(next->data()[idx]));
+            }
+            node->count += next->count;
+            node->next = next->next;
+            if (tail_ == next)
+            {
+                tail_ = node;
+            }
+            delete next;
+        }
+    }
+
+    static bool chunk_contains(const T* data, const size_t count, const T& value)
+    {
+#ifdef UNROLLED_LIST_USE_SSE2
+        if constexpr (std::is_integral<T>::value && sizeof(T) == 4)
+        {
+            // compare four elements at once
+            const __m128i needle = _mm_set1_epi32(static_cast<int>(value));
+            size_t idx = 0;
+            for (; idx + 4 <= count; idx += 4)
+            {
+                const __m128i elements = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(elements, needle)) != 0)
+                {
+                    return true;
+                }
+            }
+            for (; idx < count; ++idx)
+            {
+                if (data[idx] == value)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+#endif
+        if constexpr (std::is_arithmetic<T>::value)
+        {
+            // branch-free comparison of the whole chunk, the compiler vectorizes it
+            bool found = false;
+            for (size_t idx = 0; idx < count; ++idx)
+            {
+                found |= data[idx] == value;
+            }
+            return found;
+        }
+        else
+        {
+            return std::find(data, data + count, value) != data + count;
+        }
+    }
+
+    chunk* head_;
+    chunk* tail_;
+    size_t length_;
+};
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "insertion_sort.h"
@@ -7,25 +11,11 @@
 #include "heap_sort.h"
 #include "merge_sort.h"
 #include "quick_sort.h"
+#include "execution_policy.h"
+#include "sorting_benchmark.h"
 
-template <typename RandomIt>
-bool is_sorted(RandomIt begin, RandomIt end, bool asc = true)
-{
-    if (begin == end)
-    {
-        return true;
-    }
-
-    for (auto elem = begin + 1; elem < end; ++elem)
-    {
-        if (asc && *elem < *(elem - 1) || !asc && *elem > *(elem - 1))
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
+// arrays longer than this are not printed when sorting fails
+constexpr size_t max_printed_size = 100;
 
 template <typename T, typename SortFunc>
 void check_sorting(std::vector<std::vector<T>> test_data, SortFunc& sort_func, bool asc)
@@ -38,8 +28,27 @@ void check_sorting(std::vector<std::vector<T>> test_data, SortFunc& sort_func, b
         std::vector<T> cpy = test_array;
         sort_func(test_array.begin(), test_array.end(), asc);
 
-        const bool result = is_sorted(test_array.begin(), test_array.end(), asc);
-        if (!result)
+        // a sort that loses or duplicates elements (e.g. at the splits of a parallel merge) can still
+        // leave a sorted array, so the result is compared with std::sort of the input as well
+        std::vector<T> expected = cpy;
+        if (asc)
+        {
+            std::sort(expected.begin(), expected.end());
+        }
+        else
+        {
+            std::sort(expected.begin(), expected.end(), std::greater<T>());
+        }
+
+        // large validation runs are checked in parallel
+        const bool result = is_sorted(sort_execution::par, test_array.begin(), test_array.end(), asc) &&
+                            test_array == expected;
+        if (!result && test_array.size() > max_printed_size)
+        {
+            std::cout << "Failed to sort array of " << test_array.size() << " elements" << std::endl;
+            errors = true;
+        }
+        else if (!result)
         {
             std::cout << "Failed to sort array:" << std::endl;
             for (auto el : cpy)
@@ -64,8 +73,57 @@ void check_sorting(std::vector<std::vector<T>> test_data, SortFunc& sort_func, b
     }
 }
 
+// Sorting --benchmark [--max-size N] [--quadratic-cap N] [--min-elements N] [--algorithm name] [--seed N]
+int run_benchmark_mode(int argc, char* argv[])
+{
+    sorting_benchmark_options options;
+    for (int idx = 2; idx + 1 < argc; idx += 2)
+    {
+        const std::string arg = argv[idx];
+        const std::string value = argv[idx + 1];
+        if (arg == "--max-size")
+        {
+            options.max_size = std::max<size_t>(std::stoull(value), 16);
+        }
+        else if (arg == "--quadratic-cap")
+        {
+            options.quadratic_cap = std::stoull(value);
+        }
+        else if (arg == "--min-elements")
+        {
+            options.min_elements_per_case = std::stoull(value);
+        }
+        else if (arg == "--algorithm")
+        {
+            options.algorithm = value;
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = std::stoull(value);
+        }
+        else
+        {
+            std::cerr << "Unknown benchmark option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (argc % 2 != 0)
+    {
+        std::cerr << "Missing value of the benchmark option: " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+
+    run_sorting_benchmark(options);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "--benchmark")
+    {
+        return run_benchmark_mode(argc, argv);
+    }
+
     const std::vector<std::vector<int>> test_data{
         {55, 3, 80, 13, 4, 78, 94, 10, 88, 4, 78, 33, 1},
         {3, -1, 4, -1, 5, -9, 2, -6, 5},
@@ -123,6 +181,43 @@ int main(int argc, char* argv[])
     check_sorting(test_data, quick_sort<std::vector<int>::iterator>, true);
     check_sorting(test_data, quick_sort<std::vector<int>::iterator>, false);
     std::cout << "-----------------------------------" << std::endl << std::endl;
+
+    // the parallel sorts fall back to the sequential ones for small arrays, so they get large ones as well
+    std::vector<std::vector<int>> large_test_data = test_data;
+    std::mt19937 generator(42);
+    std::vector<int> large_random(1 << 20);
+    for (auto& elem : large_random)
+    {
+        elem = static_cast<int>(generator() % 100000);
+    }
+    std::vector<int> large_ascending(1 << 20);
+    for (size_t idx = 0; idx < large_ascending.size(); ++idx)
+    {
+        large_ascending[idx] = static_cast<int>(idx);
+    }
+    large_test_data.push_back(large_random);
+    large_test_data.push_back(large_ascending);
+    large_test_data.emplace_back(large_ascending.rbegin(), large_ascending.rend());
+
+    using iterator = std::vector<int>::iterator;
+    auto merge_sort_par = [](iterator begin, iterator end, bool asc) { merge_sort(sort_execution::par, begin, end, asc); };
+    auto quick_sort_par = [](iterator begin, iterator end, bool asc) { quick_sort(sort_execution::par, begin, end, asc); };
+    auto heap_sort_par = [](iterator begin, iterator end, bool asc) { heap_sort(sort_execution::par, begin, end, asc); };
+
+    std::cout << "Parallel merge sort:" << std::endl;
+    check_sorting(large_test_data, merge_sort_par, true);
+    check_sorting(large_test_data, merge_sort_par, false);
+    std::cout << "-----------------------------------" << std::endl << std::endl;
+
+    std::cout << "Parallel quick sort:" << std::endl;
+    check_sorting(large_test_data, quick_sort_par, true);
+    check_sorting(large_test_data, quick_sort_par, false);
+    std::cout << "-----------------------------------" << std::endl << std::endl;
+
+    std::cout << "Parallel heap sort:" << std::endl;
+    check_sorting(large_test_data, heap_sort_par, true);
+    check_sorting(large_test_data, heap_sort_par, false);
+    std::cout << "-----------------------------------" << std::endl << std::endl;
     
 
     return 0;
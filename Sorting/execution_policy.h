@@ -0,0 +1,451 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Common/thread_pool.h"
+#include "heap_sort.h"
+#include "merge_sort.h"
+#include "quick_sort.h"
+
+// execution policies of the sorts, mirroring std::execution without depending on a parallel backend:
+// seq - sequential, par - parallel on the shared thread pool, unseq - sequential with vectorizable loops,
+// par_unseq - both
+// the sorts have no vectorizable loops (every step depends on a comparison), so for them unseq is seq
+// and par_unseq is par; is_sorted has a branchless loop for unseq
+// ranges below parallel_threshold elements (or a pool of one thread) are always processed sequentially
+namespace sort_execution
+{
+    struct sequenced_policy
+    {
+    };
+
+    struct parallel_policy
+    {
+    };
+
+    struct parallel_unsequenced_policy
+    {
+    };
+
+    struct unsequenced_policy
+    {
+    };
+
+    inline constexpr sequenced_policy seq{};
+    inline constexpr parallel_policy par{};
+    inline constexpr parallel_unsequenced_policy par_unseq{};
+    inline constexpr unsequenced_policy unseq{};
+
+    template <typename Policy>
+    struct is_execution_policy : std::false_type
+    {
+    };
+
+    template <>
+    struct is_execution_policy<sequenced_policy> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_execution_policy<parallel_policy> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_execution_policy<parallel_unsequenced_policy> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_execution_policy<unsequenced_policy> : std::true_type
+    {
+    };
+
+    template <typename Policy>
+    constexpr bool is_execution_policy_v = is_execution_policy<Policy>::value;
+
+    template <typename Policy>
+    constexpr bool is_parallel_v =
+        std::is_same<Policy, parallel_policy>::value || std::is_same<Policy, parallel_unsequenced_policy>::value;
+
+    template <typename Policy>
+    constexpr bool is_unsequenced_v =
+        std::is_same<Policy, unsequenced_policy>::value || std::is_same<Policy, parallel_unsequenced_policy>::value;
+
+    // smaller ranges are sorted faster by one thread than the tasks can be scheduled and merged
+    constexpr size_t parallel_threshold = 1 << 15;
+}
+
+namespace parallel_sort_detail
+{
+    // enough tasks per thread to even out the pieces of different cost (e.g. uneven quick_sort partitions)
+    constexpr size_t tasks_per_thread = 4;
+    // smaller pieces are not worth a task
+    constexpr size_t min_grain = 1 << 13;
+    // is_sorted checks the early exit flag once per block
+    constexpr size_t check_block_size = 1 << 10;
+
+    template <typename Policy>
+    bool runs_in_parallel(const size_t size, const thread_pool& pool)
+    {
+        return sort_execution::is_parallel_v<Policy> && size >= sort_execution::parallel_threshold && pool.size() > 1;
+    }
+
+    inline size_t grain_for(const size_t size, const thread_pool& pool)
+    {
+        return std::max(min_grain, size / (pool.size() * tasks_per_thread));
+    }
+
+    // waits for all the tasks before rethrowing the first failure, so none of them outlives the range
+    template <typename Result>
+    void wait_all(std::vector<std::future<Result>>& futures)
+    {
+        std::exception_ptr failure;
+        for (auto& future : futures)
+        {
+            try
+            {
+                future.get();
+            }
+            catch (...)
+            {
+                if (!failure)
+                {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // merges the sorted runs of src (bounds[i], bounds[i + 1]) pairwise into dst, the last odd run is moved as is
+    // every pair is split along its merge path into pieces of about grain elements, one task per piece
+    template <typename SrcIt, typename DstIt, typename Comparator>
+    void merge_round(SrcIt src, DstIt dst, const std::vector<size_t>& bounds, Comparator comparator,
+                     const size_t grain, thread_pool& pool, std::vector<std::future<void>>& futures)
+    {
+        for (size_t run = 0; run + 1 < bounds.size(); run += 2)
+        {
+            const size_t left_begin = bounds[run];
+            const size_t right_begin = bounds[run + 1];
+            const size_t right_end = run + 2 < bounds.size() ? bounds[run + 2] : right_begin;
+            const size_t left_size = right_begin - left_begin;
+            const size_t right_size = right_end - right_begin;
+            const size_t total = left_size + right_size;
+
+            // split points (left, right) on the merge path: both prefixes together are the first target elements
+            const size_t pieces = std::max<size_t>(1, total / grain);
+            size_t prev_left = 0, prev_right = 0;
+            for (size_t piece = 1; piece <= pieces; ++piece)
+            {
+                const size_t target = piece == pieces ? total : total * piece / pieces;
+                size_t lo = target > right_size ? target - right_size : 0;
+                size_t hi = std::min(left_size, target);
+                while (lo < hi)
+                {
+                    // equal values are taken from the left run first, the merge stays stable
+                    const size_t middle = lo + (hi - lo) / 2;
+                    if (!comparator(src[right_begin + target - middle - 1], src[left_begin + middle]))
+                    {
+                        lo = middle + 1;
+                    }
+                    else
+                    {
+                        hi = middle;
+                    }
+                }
+                const size_t next_left = lo, next_right = target - lo;
+
+                const size_t out = left_begin + prev_left + prev_right;
+                const size_t l_begin = left_begin + prev_left, l_end = left_begin + next_left;
+                const size_t r_begin = right_begin + prev_right, r_end = right_begin + next_right;
+                futures.push_back(pool.submit([=]
+                {
+                    std::merge(std::make_move_iterator(src + l_begin), std::make_move_iterator(src + l_end),
+                               std::make_move_iterator(src + r_begin), std::make_move_iterator(src + r_end),
+                               dst + out, comparator);
+                }));
+                prev_left = next_left;
+                prev_right = next_right;
+            }
+        }
+        wait_all(futures);
+        futures.clear();
+    }
+
+    // moves src to dst in pieces of grain elements
+    template <typename SrcIt, typename DstIt>
+    void parallel_move(SrcIt src, DstIt dst, const size_t size, const size_t grain, thread_pool& pool)
+    {
+        std::vector<std::future<void>> futures;
+        for (size_t begin = 0; begin < size; begin += grain)
+        {
+            const size_t end = std::min(size, begin + grain);
+            futures.push_back(pool.submit([=] { std::move(src + begin, src + end, dst + begin); }));
+        }
+        wait_all(futures);
+    }
+
+    // sorts the chunks of the range with chunk_sort in the pool, then merges them in rounds,
+    // every round merges pairs of runs in parallel, so the range is done in log2(chunks) rounds
+    // the tasks never wait for each other: the calling thread waits for the end of every round
+    template <typename RandomIt, typename Comparator, typename ChunkSort>
+    void sort_chunks_and_merge(RandomIt begin, RandomIt end, Comparator comparator, ChunkSort chunk_sort,
+                               thread_pool& pool)
+    {
+        using T = typename std::iterator_traits<RandomIt>::value_type;
+        const auto size = static_cast<size_t>(end - begin);
+        const size_t grain = grain_for(size, pool);
+        const size_t chunks = std::max<size_t>(2, std::min(pool.size(), size / min_grain));
+
+        std::vector<size_t> bounds;
+        std::vector<std::future<void>> futures;
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            const size_t chunk_begin = size * chunk / chunks;
+            const size_t chunk_end = size * (chunk + 1) / chunks;
+            bounds.push_back(chunk_begin);
+            futures.push_back(pool.submit([=] { chunk_sort(begin + chunk_begin, begin + chunk_end); }));
+        }
+        bounds.push_back(size);
+        wait_all(futures);
+        futures.clear();
+
+        merge_buffer<T> buffer(size);
+        bool in_buffer = false;
+        while (bounds.size() > 2)
+        {
+            if (in_buffer)
+            {
+                merge_round(buffer.begin(), begin, bounds, comparator, grain, pool, futures);
+            }
+            else
+            {
+                merge_round(begin, buffer.begin(), bounds, comparator, grain, pool, futures);
+            }
+            in_buffer = !in_buffer;
+
+            // every pair became one run
+            std::vector<size_t> merged_bounds;
+            for (size_t run = 0; run < bounds.size(); run += 2)
+            {
+                merged_bounds.push_back(bounds[run]);
+            }
+            if (merged_bounds.back() != size)
+            {
+                merged_bounds.push_back(size);
+            }
+            bounds.swap(merged_bounds);
+        }
+
+        if (in_buffer)
+        {
+            parallel_move(buffer.begin(), begin, size, grain, pool);
+        }
+    }
+
+    // true if no element of [begin, end) is less than the previous one, the first element is compared with *(begin - 1)
+    // unless begin is first; stops early when another task has already found a violation
+    template <bool Vectorized, typename RandomIt, typename Comparator>
+    bool check_sorted(const RandomIt first, RandomIt begin, const RandomIt end, Comparator comparator,
+                      const std::atomic<bool>* unsorted_found = nullptr)
+    {
+        if (begin == first && begin != end)
+        {
+            ++begin;
+        }
+        while (begin < end)
+        {
+            const RandomIt block_end = end - begin > static_cast<std::ptrdiff_t>(check_block_size)
+                                           ? begin + check_block_size
+                                           : end;
+            if constexpr (Vectorized)
+            {
+                // no branches inside the block, the compiler can vectorize the comparisons
+                bool unsorted = false;
+                for (RandomIt elem = begin; elem < block_end; ++elem)
+                {
+                    unsorted |= comparator(*elem, *(elem - 1));
+                }
+                if (unsorted)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                for (RandomIt elem = begin; elem < block_end; ++elem)
+                {
+                    if (comparator(*elem, *(elem - 1)))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            if (unsorted_found && unsorted_found->load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            begin = block_end;
+        }
+        return true;
+    }
+}
+
+// SORTS WITH EXECUTION POLICIES
+// call sites opt into parallelism with the first argument: merge_sort(sort_execution::par, v.begin(), v.end())
+
+// par: chunks are merge sorted in the pool and merged in parallel rounds
+template <typename ExecutionPolicy, typename RandomIt,
+          typename = std::enable_if_t<sort_execution::is_execution_policy_v<ExecutionPolicy>>>
+void merge_sort(const ExecutionPolicy&, RandomIt begin, RandomIt end, const bool asc = true)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    thread_pool& pool = thread_pool::shared();
+    if (!parallel_sort_detail::runs_in_parallel<ExecutionPolicy>(static_cast<size_t>(end - begin), pool))
+    {
+        merge_sort(begin, end, asc);
+        return;
+    }
+
+    auto comparator = asc
+                          ? [](const T& l, const T& r) -> bool { return l < r; }
+                          : [](const T& l, const T& r) -> bool { return r < l; };
+    parallel_sort_detail::sort_chunks_and_merge(
+        begin, end, comparator, [asc](RandomIt chunk_begin, RandomIt chunk_end) { merge_sort(chunk_begin, chunk_end, asc); },
+        pool);
+}
+
+// par: the calling thread partitions the range until the parts are small enough, the parts are sorted in the pool
+// (the partitions above them are sequential, so the speedup is bounded, but the sort stays in place)
+template <typename ExecutionPolicy, typename RandomIt,
+          typename = std::enable_if_t<sort_execution::is_execution_policy_v<ExecutionPolicy>>>
+void quick_sort(const ExecutionPolicy&, RandomIt begin, RandomIt end, const bool asc = true)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    thread_pool& pool = thread_pool::shared();
+    const auto size = static_cast<size_t>(end - begin);
+    if (!parallel_sort_detail::runs_in_parallel<ExecutionPolicy>(size, pool))
+    {
+        quick_sort(begin, end, asc);
+        return;
+    }
+
+    // same comparators as the sequential quick_sort
+    auto comparator_l = asc
+                            ? [](const T& l, const T& r) -> bool { return l < r; }
+                            : [](const T& l, const T& r) -> bool { return l > r; };
+    auto comparator_r = asc
+                            ? [](const T& l, const T& r) -> bool { return l > r; }
+                            : [](const T& l, const T& r) -> bool { return l < r; };
+
+    const size_t grain = parallel_sort_detail::grain_for(size, pool);
+    std::vector<std::future<void>> futures;
+    // explicit stack: a bad pivot would make the recursion as deep as the range
+    std::vector<std::pair<RandomIt, RandomIt>> pending{{begin, end}};
+    try
+    {
+        while (!pending.empty())
+        {
+            const RandomIt part_begin = pending.back().first;
+            const RandomIt part_end = pending.back().second;
+            pending.pop_back();
+            if (part_end - part_begin <= 1)
+            {
+                continue;
+            }
+            // small parts are sorted while the calling thread keeps partitioning
+            if (static_cast<size_t>(part_end - part_begin) <= grain)
+            {
+                futures.push_back(pool.submit([=] { quick_sort_impl(part_begin, part_end, comparator_l, comparator_r); }));
+                continue;
+            }
+
+            const RandomIt pivot = quick_sort_partition(part_begin, part_end, comparator_l, comparator_r);
+            pending.emplace_back(part_begin, pivot);
+            pending.emplace_back(pivot + 1, part_end);
+        }
+    }
+    catch (...)
+    {
+        // the submitted tasks still work on the range
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+        throw;
+    }
+    parallel_sort_detail::wait_all(futures);
+}
+
+// par: chunks are heap sorted in the pool and merged in parallel rounds,
+// unlike the sequential heap_sort it needs a buffer of the range size for the merges
+template <typename ExecutionPolicy, typename RandomIt,
+          typename = std::enable_if_t<sort_execution::is_execution_policy_v<ExecutionPolicy>>>
+void heap_sort(const ExecutionPolicy&, RandomIt begin, RandomIt end, const bool asc = true)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    thread_pool& pool = thread_pool::shared();
+    if (!parallel_sort_detail::runs_in_parallel<ExecutionPolicy>(static_cast<size_t>(end - begin), pool))
+    {
+        heap_sort(begin, end, asc);
+        return;
+    }
+
+    auto comparator = asc
+                          ? [](const T& l, const T& r) -> bool { return l < r; }
+                          : [](const T& l, const T& r) -> bool { return l > r; };
+    parallel_sort_detail::sort_chunks_and_merge(
+        begin, end, comparator, [asc](RandomIt chunk_begin, RandomIt chunk_end) { heap_sort(chunk_begin, chunk_end, asc); },
+        pool);
+}
+
+// true if the range is sorted in the ascending (asc) or descending order
+// par splits the range between the tasks, they stop early once any of them finds a violation
+template <typename ExecutionPolicy, typename RandomIt,
+          typename = std::enable_if_t<sort_execution::is_execution_policy_v<ExecutionPolicy>>>
+bool is_sorted(const ExecutionPolicy&, RandomIt begin, RandomIt end, const bool asc = true)
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    constexpr bool vectorized = sort_execution::is_unsequenced_v<ExecutionPolicy>;
+
+    // the element is out of order if it's less than the previous one (greater for descending)
+    auto comparator = asc
+                          ? [](const T& elem, const T& prev) -> bool { return elem < prev; }
+                          : [](const T& elem, const T& prev) -> bool { return elem > prev; };
+
+    thread_pool& pool = thread_pool::shared();
+    const auto size = static_cast<size_t>(end - begin);
+    if (!parallel_sort_detail::runs_in_parallel<ExecutionPolicy>(size, pool))
+    {
+        return parallel_sort_detail::check_sorted<vectorized>(begin, begin, end, comparator);
+    }
+
+    const size_t grain = parallel_sort_detail::grain_for(size, pool);
+    std::atomic<bool> unsorted_found{false};
+    std::vector<std::future<void>> futures;
+    for (size_t part_begin = 0; part_begin < size; part_begin += grain)
+    {
+        const size_t part_end = std::min(size, part_begin + grain);
+        futures.push_back(pool.submit([=, &unsorted_found]
+        {
+            if (!parallel_sort_detail::check_sorted<vectorized>(begin, begin + part_begin, begin + part_end, comparator,
+                                                                &unsorted_found))
+            {
+                unsorted_found.store(true, std::memory_order_relaxed);
+            }
+        }));
+    }
+    parallel_sort_detail::wait_all(futures);
+    return !unsorted_found.load(std::memory_order_relaxed);
+}
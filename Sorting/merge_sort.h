@@ -2,9 +2,15 @@
 #include <iterator>
 #include <vector>
 
+#include "../Common/allocation_accounting.h"
+
+// buffer for merging, its memory is reported to the global allocation account (see allocation_accounting.h)
+template <typename T>
+using merge_buffer = std::vector<T, accounting_allocator<T>>;
+
 template <typename RandomIt, typename Comparator>
 void merge_arrays(RandomIt begin_l, RandomIt end_l, RandomIt begin_r, RandomIt end_r,
-                  std::vector<typename std::iterator_traits<RandomIt>::value_type>& temp_vec,
+                  merge_buffer<typename std::iterator_traits<RandomIt>::value_type>& temp_vec,
                   Comparator comparator)
 {
     auto elem_l = begin_l, elem_r = begin_r;
@@ -53,7 +59,7 @@ void merge_arrays(RandomIt begin_l, RandomIt end_l, RandomIt begin_r, RandomIt e
 
 template <typename RandomIt, typename Comparator>
 void merge_sort_impl(RandomIt begin, RandomIt end,
-                     std::vector<typename std::iterator_traits<RandomIt>::value_type>& temp_vec, Comparator comparator)
+                     merge_buffer<typename std::iterator_traits<RandomIt>::value_type>& temp_vec, Comparator comparator)
 {
     RandomIt middle_elem = begin + (end - begin) / 2;
     if (end - begin > 1)
@@ -68,7 +74,7 @@ template <typename RandomIt>
 void merge_sort(RandomIt begin, RandomIt end, bool asc = true)
 {
     using T = typename std::iterator_traits<RandomIt>::value_type;
-    std::vector<T> temp_vec(end - begin);
+    merge_buffer<T> temp_vec(end - begin);
 
     auto comparator = asc
                           ? [](const T& l, const T& r) -> bool { return l < r; }
@@ -1,15 +1,10 @@
 #pragma once
 #include <iterator>
 
-// recursively sorts data structure with help of pivot and left-right pointers
+// splits the range around the pivot with left-right pointers, returns the final position of the pivot
 template <typename RandomIt, typename Comparator>
-void quick_sort_impl(RandomIt begin, RandomIt end, Comparator comparator_l, Comparator comparator_r)
+RandomIt quick_sort_partition(RandomIt begin, RandomIt end, Comparator comparator_l, Comparator comparator_r)
 {
-    if (end - begin <= 1)
-    {
-        return;
-    }
-
     // select the pivot - middle element of the array
     RandomIt pivot = begin + (end - begin - 1) / 2;
 
@@ -54,6 +49,19 @@ void quick_sort_impl(RandomIt begin, RandomIt end, Comparator comparator_l, Comp
             ++left;
         }
     }
+    return pivot;
+}
+
+// recursively sorts data structure with help of pivot and left-right pointers
+template <typename RandomIt, typename Comparator>
+void quick_sort_impl(RandomIt begin, RandomIt end, Comparator comparator_l, Comparator comparator_r)
+{
+    if (end - begin <= 1)
+    {
+        return;
+    }
+
+    RandomIt pivot = quick_sort_partition(begin, end, comparator_l, comparator_r);
 
     // recursively sort sub-array to the left of the pivot
     quick_sort_impl(begin, pivot, comparator_l, comparator_r);
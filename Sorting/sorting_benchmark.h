@@ -0,0 +1,410 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bubble_sort.h"
+#include "execution_policy.h"
+#include "heap_sort.h"
+#include "insertion_sort.h"
+#include "merge_sort.h"
+#include "quick_sort.h"
+#include "selection_sort.h"
+
+// benchmark mode of the sorting driver: every algorithm of the directory and the std baselines
+// over the sizes and the input distributions, reports time, comparisons and hardware counters per element
+
+struct sorting_benchmark_options
+{
+    // sizes go from 16 up to max_size by the factor of 16, max_size itself is the last one
+    size_t max_size = 1 << 20;
+    // bubble, insertion and selection sorts and the cases found quadratic are skipped above this size
+    size_t quadratic_cap = 1 << 14;
+    // small inputs are sorted repeatedly until this many elements were sorted, for the timer resolution
+    size_t min_elements_per_case = 1 << 22;
+    // percents of the displaced elements of the nearly sorted inputs
+    std::vector<unsigned> perturbations{1, 10};
+    std::string algorithm;
+    uint64_t seed = 42;
+};
+
+// COMPARISON COUNTING
+
+inline uint64_t& comparison_count()
+{
+    static uint64_t count = 0;
+    return count;
+}
+
+// wraps the element and counts its comparisons, the sorts use both < and >
+template <typename T>
+struct counted_element
+{
+    T value;
+
+    friend bool operator<(const counted_element& l, const counted_element& r)
+    {
+        ++comparison_count();
+        return l.value < r.value;
+    }
+
+    friend bool operator>(const counted_element& l, const counted_element& r)
+    {
+        ++comparison_count();
+        return l.value > r.value;
+    }
+};
+
+// element with a big payload: the moves cost much more than the comparisons
+struct sorting_record
+{
+    uint64_t key;
+    char payload[120];
+
+    friend bool operator<(const sorting_record& l, const sorting_record& r)
+    {
+        return l.key < r.key;
+    }
+
+    friend bool operator>(const sorting_record& l, const sorting_record& r)
+    {
+        return l.key > r.key;
+    }
+};
+
+// HARDWARE COUNTERS
+
+// cycles, branch misses and cache misses of the calling thread through perf_event_open
+// not available outside of linux, or when the kernel forbids the access (perf_event_paranoid, containers)
+class hardware_counters
+{
+public:
+    enum counter { cycles, branch_misses, cache_misses, count };
+
+    hardware_counters()
+    {
+#ifdef __linux__
+        const uint64_t configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_BRANCH_MISSES,
+                                         PERF_COUNT_HW_CACHE_MISSES};
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[idx];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            descriptors_[idx] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    hardware_counters(const hardware_counters& other) = delete;
+    hardware_counters& operator=(const hardware_counters& other) = delete;
+
+    bool available(const counter which) const
+    {
+        return descriptors_[which] >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        for (const int fd : descriptors_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // adds the counted events since start() to the totals
+    void stop()
+    {
+#ifdef __linux__
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            if (descriptors_[idx] >= 0)
+            {
+                ioctl(descriptors_[idx], PERF_EVENT_IOC_DISABLE, 0);
+                uint64_t value = 0;
+                if (read(descriptors_[idx], &value, sizeof(value)) == sizeof(value))
+                {
+                    totals_[idx] += value;
+                }
+            }
+        }
+#endif
+    }
+
+    uint64_t total(const counter which) const
+    {
+        return totals_[which];
+    }
+
+    void reset_totals()
+    {
+        std::fill(std::begin(totals_), std::end(totals_), 0);
+    }
+
+    ~hardware_counters()
+    {
+#ifdef __linux__
+        for (const int fd : descriptors_)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+private:
+    int descriptors_[count] = {-1, -1, -1};
+    uint64_t totals_[count] = {0, 0, 0};
+};
+
+// INPUT DISTRIBUTIONS
+
+struct sorting_input
+{
+    std::string name;
+    std::vector<uint64_t> keys;
+};
+
+inline std::vector<sorting_input> make_sorting_inputs(const size_t n, const sorting_benchmark_options& options,
+                                                      std::mt19937_64& generator)
+{
+    std::vector<sorting_input> inputs;
+    std::vector<uint64_t> ascending(n);
+    for (size_t idx = 0; idx < n; ++idx)
+    {
+        ascending[idx] = idx;
+    }
+
+    std::vector<uint64_t> random(n);
+    for (auto& key : random)
+    {
+        key = generator() >> 32;
+    }
+    inputs.push_back({"random", random});
+    inputs.push_back({"sorted", ascending});
+    inputs.push_back({"reversed", std::vector<uint64_t>(ascending.rbegin(), ascending.rend())});
+
+    // ascending to the middle, then descending
+    std::vector<uint64_t> organ_pipe(n);
+    for (size_t idx = 0; idx < n; ++idx)
+    {
+        organ_pipe[idx] = idx < n / 2 ? idx : n - 1 - idx;
+    }
+    inputs.push_back({"organ_pipe", organ_pipe});
+
+    // 32 ascending runs
+    std::vector<uint64_t> sawtooth(n);
+    const size_t run = std::max<size_t>(n / 32, 1);
+    for (size_t idx = 0; idx < n; ++idx)
+    {
+        sawtooth[idx] = idx % run;
+    }
+    inputs.push_back({"sawtooth", sawtooth});
+
+    std::vector<uint64_t> few_unique(n);
+    for (auto& key : few_unique)
+    {
+        key = generator() % 16;
+    }
+    inputs.push_back({"few_unique", few_unique});
+
+    // sorted with the given percent of the elements swapped with random positions
+    for (const unsigned percent : options.perturbations)
+    {
+        std::vector<uint64_t> nearly_sorted = ascending;
+        std::uniform_int_distribution<size_t> position(0, n - 1);
+        for (size_t swaps = n * percent / 200; swaps > 0; --swaps)
+        {
+            std::swap(nearly_sorted[position(generator)], nearly_sorted[position(generator)]);
+        }
+        inputs.push_back({"nearly_sorted_" + std::to_string(percent) + "pct", nearly_sorted});
+    }
+
+    return inputs;
+}
+
+template <typename T>
+T make_sorting_element(uint64_t key);
+
+template <>
+inline uint32_t make_sorting_element<uint32_t>(const uint64_t key)
+{
+    return static_cast<uint32_t>(key);
+}
+
+template <>
+inline sorting_record make_sorting_element<sorting_record>(const uint64_t key)
+{
+    sorting_record record{};
+    record.key = key;
+    std::memset(record.payload, static_cast<int>(key & 0xff), sizeof(record.payload));
+    return record;
+}
+
+// MEASUREMENT
+
+// sorts copies of the input repeatedly, only the sorting itself is measured
+// returns the number of comparisons per element
+template <typename T, typename SortFunc>
+double run_sorting_case(const char* algorithm, const std::string& distribution, const std::vector<uint64_t>& keys,
+                      SortFunc sort_func, const sorting_benchmark_options& options, hardware_counters& counters)
+{
+    const size_t n = keys.size();
+    const size_t repetitions = std::max<size_t>(1, options.min_elements_per_case / std::max<size_t>(n, 1));
+
+    std::vector<T> input(n);
+    std::vector<counted_element<T>> counted_input(n);
+    for (size_t idx = 0; idx < n; ++idx)
+    {
+        input[idx] = make_sorting_element<T>(keys[idx]);
+        counted_input[idx].value = input[idx];
+    }
+
+    counters.reset_totals();
+    double nanoseconds = 0;
+    bool sorted = true;
+    std::vector<T> data;
+    for (size_t repetition = 0; repetition < repetitions; ++repetition)
+    {
+        data = input;
+        const auto start = std::chrono::steady_clock::now();
+        counters.start();
+        sort_func(data.begin(), data.end());
+        counters.stop();
+        const auto end = std::chrono::steady_clock::now();
+        nanoseconds += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        sorted = sorted && is_sorted(sort_execution::par, data.begin(), data.end());
+    }
+
+    // comparisons are counted in a separate run, the counting would distort the timing
+    comparison_count() = 0;
+    sort_func(counted_input.begin(), counted_input.end());
+    const uint64_t comparisons = comparison_count();
+
+    const double elements = static_cast<double>(n) * static_cast<double>(repetitions);
+    const auto per_element = [&counters, elements](const hardware_counters::counter which) -> std::string
+    {
+        if (!counters.available(which))
+        {
+            return "";
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(counters.total(which)) / elements);
+        return buffer;
+    };
+
+    const double comparisons_per_element = static_cast<double>(comparisons) / static_cast<double>(std::max<size_t>(n, 1));
+    char numbers[96];
+    std::snprintf(numbers, sizeof(numbers), "%zu,%zu,%.3f,%.3f", n, repetitions, nanoseconds / elements,
+                  comparisons_per_element);
+    std::cout << algorithm << ',' << distribution << ',' << numbers << ','
+              << per_element(hardware_counters::cycles) << ',' << per_element(hardware_counters::branch_misses) << ','
+              << per_element(hardware_counters::cache_misses) << ',' << (sorted ? "ok" : "FAILED") << std::endl;
+    return comparisons_per_element;
+}
+
+// algorithm/distribution pairs that turned out quadratic, they are skipped at all the bigger sizes regardless of
+// the quadratic cap (quick_sort with the middle pivot degrades on organ_pipe, and its recursion depth grows
+// linearly, so at the big sizes it would overflow the stack)
+using degenerate_cases = std::set<std::string>;
+
+template <typename T>
+void run_sorting_algorithms(const std::string& distribution, const std::vector<uint64_t>& keys,
+                            const sorting_benchmark_options& options, hardware_counters& counters,
+                            degenerate_cases& degenerate)
+{
+    const size_t n = keys.size();
+
+    // generic lambdas as sort_func, so the same sort runs on the plain and on the counted elements
+    const auto run = [&](const char* algorithm, const bool quadratic, auto sort_func)
+    {
+        const std::string pair = std::string(algorithm) + "/" + distribution;
+        if ((!options.algorithm.empty() && options.algorithm != algorithm) ||
+            (n > options.quadratic_cap && quadratic) || degenerate.count(pair) > 0)
+        {
+            return;
+        }
+
+        const double comparisons = run_sorting_case<T>(algorithm, distribution, keys, sort_func, options, counters);
+        if (!quadratic && comparisons > 4 * std::log2(static_cast<double>(n)) + 16 && degenerate.insert(pair).second)
+        {
+            std::cerr << algorithm << " is quadratic on " << distribution << ", skipping it above " << n
+                      << " elements" << std::endl;
+        }
+    };
+
+    run("bubble_sort", true, [](auto begin, auto end) { bubble_sort(begin, end); });
+    run("insertion_sort", true, [](auto begin, auto end) { insertion_sort(begin, end); });
+    run("selection_sort", true, [](auto begin, auto end) { selection_sort(begin, end); });
+    run("heap_sort", false, [](auto begin, auto end) { heap_sort(begin, end); });
+    run("merge_sort", false, [](auto begin, auto end) { merge_sort(begin, end); });
+    run("quick_sort", false, [](auto begin, auto end) { quick_sort(begin, end); });
+    run("std::sort", false, [](auto begin, auto end) { std::sort(begin, end); });
+    run("std::stable_sort", false, [](auto begin, auto end) { std::stable_sort(begin, end); });
+}
+
+inline void run_sorting_benchmark(const sorting_benchmark_options& options)
+{
+    std::vector<size_t> sizes;
+    for (size_t size = 16; size < options.max_size; size *= 16)
+    {
+        sizes.push_back(size);
+    }
+    sizes.push_back(options.max_size);
+
+    hardware_counters counters;
+    degenerate_cases degenerate;
+    if (!counters.available(hardware_counters::cycles))
+    {
+        std::cerr << "Hardware counters are not available, their columns are left empty" << std::endl;
+    }
+
+    std::cout << "algorithm,distribution,size,repetitions,ns_per_element,comparisons_per_element,"
+                 "cycles_per_element,branch_misses_per_element,cache_misses_per_element,result"
+              << std::endl;
+
+    std::mt19937_64 generator(options.seed);
+    for (const size_t size : sizes)
+    {
+        for (const auto& input : make_sorting_inputs(size, options, generator))
+        {
+            run_sorting_algorithms<uint32_t>(input.name, input.keys, options, counters, degenerate);
+        }
+
+        // large records only for the random keys
+        std::vector<uint64_t> record_keys(size);
+        for (auto& key : record_keys)
+        {
+            key = generator();
+        }
+        run_sorting_algorithms<sorting_record>("random_records_128b", record_keys, options, counters, degenerate);
+    }
+}